@@ -0,0 +1,61 @@
+#include "arena.hpp"
+#include <cassert>
+
+// defines Arena's methods and the arenas of threads
+
+void* Arena::Overflow::do_allocate(std::size_t bytes, std::size_t alignment)
+{
+  bytes_ += bytes;
+  return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+}
+
+void Arena::Overflow::do_deallocate(void* p, std::size_t bytes,
+                                    std::size_t alignment)
+{
+  std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+}
+
+bool Arena::Overflow::do_is_equal(memory_resource const& other) const noexcept
+{
+  return this == &other;
+}
+
+Arena::Arena(std::size_t bytes)
+    : buffer_(bytes)
+{
+  resource_.emplace(buffer_.data(), buffer_.size(), &overflow_);
+}
+
+void Arena::reset()
+{
+  if (overflow_.bytes() == 0) {
+    resource_->release(); // back to the start of the buffer
+    return;
+  }
+  // the buffer was too small: it is enlarged to hold all of last round
+  std::size_t const needed{buffer_.size() + overflow_.bytes()};
+  resource_.reset(); // gives overflow memory back to the heap
+  overflow_.clear();
+  buffer_.assign(needed, std::byte{0});
+  resource_.emplace(buffer_.data(), buffer_.size(), &overflow_);
+}
+
+Arena::Scope::Scope(Arena& arena)
+    : arena_{arena}
+{
+  ++arena_.scopes_;
+}
+
+Arena::Scope::~Scope()
+{
+  assert(arena_.scopes_ > 0);
+  if (--arena_.scopes_ == 0) {
+    arena_.reset();
+  }
+}
+
+Arena& thread_arena()
+{
+  thread_local Arena arena{};
+  return arena;
+}
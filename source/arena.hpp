@@ -0,0 +1,76 @@
+#ifndef ARENA_HPP
+#define ARENA_HPP
+
+#include <cstddef>
+#include <memory_resource>
+#include <optional>
+#include <vector>
+
+// defines Arena, the scratch memory flying rules take their temporary vectors
+// from instead of allocating them on the heap
+
+// a buffer handed out by a monotonic memory resource: allocating is bumping a
+// pointer, deallocating is a no-op and all memory is given back at once when
+// the outermost Scope ends. If a round needs more than the buffer, the excess
+// comes from the heap and the buffer is enlarged for the next rounds, so that
+// after warm-up no heap allocation happens at all
+class Arena
+{
+  // upstream of the monotonic resource, recording how much it was asked for
+  class Overflow : public std::pmr::memory_resource
+  {
+    std::size_t bytes_{0};
+    void* do_allocate(std::size_t bytes, std::size_t alignment) override;
+    void do_deallocate(void* p, std::size_t bytes,
+                       std::size_t alignment) override;
+    bool do_is_equal(memory_resource const& other) const noexcept override;
+
+   public:
+    std::size_t bytes() const
+    {
+      return bytes_;
+    }
+    void clear()
+    {
+      bytes_ = 0;
+    }
+  };
+
+  std::vector<std::byte> buffer_;
+  Overflow overflow_;
+  std::optional<std::pmr::monotonic_buffer_resource> resource_;
+  int scopes_{0}; // Scopes alive
+
+  void reset();
+
+ public:
+  explicit Arena(std::size_t bytes = 64 * 1024);
+  Arena(Arena const&) = delete;
+  Arena& operator=(Arena const&) = delete;
+  std::pmr::memory_resource* resource()
+  {
+    return &*resource_;
+  }
+  std::size_t capacity() const
+  {
+    return buffer_.size();
+  }
+
+  // memory taken from the arena is valid while a Scope is alive. Scopes nest:
+  // only the end of the outermost one gives memory back
+  class Scope
+  {
+    Arena& arena_;
+
+   public:
+    explicit Scope(Arena& arena);
+    Scope(Scope const&) = delete;
+    Scope& operator=(Scope const&) = delete;
+    ~Scope();
+  };
+};
+
+// arena of the calling thread
+Arena& thread_arena();
+
+#endif
@@ -0,0 +1,601 @@
+#include "flock.hpp"
+#include "lockstep.hpp"
+#include "parameters.hpp"
+#include "random.hpp"
+#include "stats.hpp"
+
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <functional>
+#include <limits>
+#include <map>
+#include <sstream>
+#include <string>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+// benchmarks: each one prints how a change affects run time and capture
+// statistics. Usage: bench <benchmark> [simulations]
+
+namespace {
+
+// parameters of main.cpp's defaults, with [steps] steps
+Parameters default_parameters(int steps, int N_boids = 120, int N_preds = 1,
+                              int seek_type = 0, double angle = 300.)
+{
+  return Parameters{angle, 35., 3.5,   .7,    .045,    .8,      80.,
+                    .05,   200, steps, 40,    steps,   N_boids, N_preds,
+                    seek_type};
+}
+
+// NB time points are not subtracted directly: the call would be ambiguous
+// with boids.hpp's operator- template
+double seconds_since(std::chrono::steady_clock::time_point start)
+{
+  using clock = std::chrono::steady_clock;
+  auto const ticks{clock::now().time_since_epoch().count()
+                   - start.time_since_epoch().count()};
+  return static_cast<double>(ticks) * clock::period::num / clock::period::den;
+}
+
+// hardware counter of the cache misses of the calling thread (and of the
+// threads it spawns while counting), read through perf_event_open. Where no
+// counter is available (other systems, containers, restrictive
+// perf_event_paranoid) stop returns -1
+class Cache_misses
+{
+  int fd_{-1};
+
+ public:
+  Cache_misses()
+  {
+#ifdef __linux__
+    perf_event_attr attr{};
+    attr.size           = sizeof(attr);
+    attr.type           = PERF_TYPE_HARDWARE;
+    attr.config         = PERF_COUNT_HW_CACHE_MISSES;
+    attr.disabled       = 1;
+    attr.inherit        = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv     = 1;
+    fd_ = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+#endif
+  }
+  Cache_misses(Cache_misses const&) = delete;
+  Cache_misses& operator=(Cache_misses const&) = delete;
+  ~Cache_misses()
+  {
+#ifdef __linux__
+    if (fd_ != -1) {
+      close(fd_);
+    }
+#endif
+  }
+  void start()
+  {
+#ifdef __linux__
+    if (fd_ != -1) {
+      ioctl(fd_, PERF_EVENT_IOC_RESET, 0);
+      ioctl(fd_, PERF_EVENT_IOC_ENABLE, 0);
+    }
+#endif
+  }
+  long long stop()
+  {
+    long long count{-1};
+#ifdef __linux__
+    if (fd_ != -1) {
+      ioctl(fd_, PERF_EVENT_IOC_DISABLE, 0);
+      if (read(fd_, &count, sizeof(count)) != sizeof(count)) {
+        count = -1;
+      }
+    }
+#endif
+    return count;
+  }
+};
+
+struct Batch
+{
+  std::vector<double> counts; // preys eaten in each simulation
+  double seconds;             // mean wall time per simulation
+  double steps;               // mean steps per simulation
+};
+
+// regular boids crowded in the four corner refuges and in a tight flock at
+// the centre of the box, with random headings: the worst case for a uniform
+// grid tuned on average density
+std::vector<Boid>& fill_clustered(std::vector<Boid>& boids,
+                                  Parameters const& pars, unsigned int seed,
+                                  int simulation)
+{
+  Philox const gen{seed, static_cast<std::uint32_t>(simulation),
+                   Stream::preys};
+  double const width{pars.get_x_max() - pars.get_x_min()};
+  double const height{pars.get_y_max() - pars.get_y_min()};
+  std::array<Position, 5> const centres{
+      {{pars.get_x_min() + .03 * width, pars.get_y_min() + .03 * height},
+       {pars.get_x_max() - .03 * width, pars.get_y_min() + .03 * height},
+       {pars.get_x_min() + .03 * width, pars.get_y_max() - .03 * height},
+       {pars.get_x_max() - .03 * width, pars.get_y_max() - .03 * height},
+       {pars.get_x_min() + .5 * width, pars.get_y_min() + .5 * height}}};
+  for (int i{0}; i != pars.get_N_boids(); ++i) {
+    auto const bits{gen(i)};
+    Position const& centre{centres[i % 5]};
+    double const speed{uniform(bits[2], 1.1 * pars.get_min_speed(),
+                               .9 * pars.get_max_speed())};
+    double const heading{uniform(bits[3], 0., 2. * pi)};
+    Position const p{centre.x() + uniform(bits[0], -.03, .03) * width,
+                     centre.y() + uniform(bits[1], -.03, .03) * height};
+    Velocity const v{speed * std::cos(heading), speed * std::sin(heading)};
+    boids.push_back(Boid{p, v});
+  }
+  return boids;
+}
+
+// simulations share seed and indices, so that batches only differ in pars
+// (and, if clustered, in the initial conditions)
+Batch run_batch(Parameters const& pars, int sims, unsigned int seed = 2024u,
+                bool clustered = false)
+{
+  Batch batch{{}, 0., 0.};
+  auto const start{std::chrono::steady_clock::now()};
+  for (int i{0}; i != sims; ++i) {
+    std::vector<Boid> boids{};
+    Flock flock{clustered ? fill_clustered(boids, pars, seed, i)
+                          : fill(boids, pars, seed, i)};
+    add_predators(flock, pars, seed, i);
+    batch.steps += simulate(flock, pars);
+    batch.counts.push_back(flock.counter());
+  }
+  batch.seconds = seconds_since(start) / sims;
+  batch.steps /= sims;
+  return batch;
+}
+
+// z-score of the shift of the mean preys eaten from reference to batch. The
+// batches share seed and indices, i.e. they are paired: the standard error is
+// the one of the differences between their simulations. If the differences
+// are all the same, z is 0 if they are 0, infinite otherwise
+double paired_z(Batch const& batch, Batch const& reference)
+{
+  std::vector<double> const diffs{differences(batch.counts, reference.counts)};
+  double const shift{mean(diffs)};
+  double const se{std_error(diffs)};
+  if (se > 0.) {
+    return shift / se;
+  }
+  return (shift == 0.)
+           ? 0.
+           : std::copysign(std::numeric_limits<double>::infinity(), shift);
+}
+
+void print_batch(std::string const& label, Batch const& batch,
+                 Batch const& reference)
+{
+  std::cout << std::setw(28) << std::left << label << std::right
+            << std::setprecision(2) << std::fixed << std::setw(8)
+            << mean(batch.counts) << " +- " << std::setw(5)
+            << std_error(batch.counts) << "  z vs reference: " << std::setw(6)
+            << paired_z(batch, reference) << "  s/sim: " << std::setw(6)
+            << std::setprecision(3) << batch.seconds
+            << "  steps: " << std::setprecision(0) << batch.steps << '\n';
+}
+
+// capture statistics with fewer (longer) steps, with and without swept
+// capture detection. Reference is main.cpp's default of 2000 steps. NB with
+// max_speed 80 and d_t .1 a predator covers 8 units per step against a
+// capture radius of 1, so discrete detection misses captures even there
+void capture(int sims)
+{
+  Batch const reference{run_batch(default_parameters(2000), sims)};
+  print_batch("steps 2000 (reference)", reference, reference);
+  for (int steps : {2000, 1000, 500, 250}) {
+    Parameters pars{default_parameters(steps)};
+    if (steps != 2000) {
+      print_batch("steps " + std::to_string(steps) + " discrete",
+                  run_batch(pars, sims), reference);
+    }
+    pars.set_swept_capture() = true;
+    print_batch("steps " + std::to_string(steps) + " swept",
+                run_batch(pars, sims), reference);
+  }
+}
+
+// validation harness for larger d_t: for each integrator, steps are halved
+// until the distribution of preys eaten becomes distinguishable (two-sample
+// KS test at 5%, or mean shifted by more than two standard errors of the
+// paired differences, see paired_z) from the one of explicit Euler with 2000
+// steps. Capture detection is the same for reference and candidates, since
+// swept detection alone changes the counts
+void integrators(int sims)
+{
+  std::array<std::pair<Integrator, std::string>, 3> const schemes{
+      {{Integrator::euler, "euler"},
+       {Integrator::semi_implicit, "semi-implicit"},
+       {Integrator::verlet, "verlet"}}};
+  for (bool swept : {false, true}) {
+    std::string const capture{swept ? " swept " : " discrete "};
+    Parameters ref_pars{default_parameters(2000)};
+    ref_pars.set_swept_capture() = swept;
+    Batch const reference{run_batch(ref_pars, sims)};
+    print_batch("euler" + capture + "2000 (ref)", reference, reference);
+    for (auto const& [integrator, name] : schemes) {
+      int smallest{0};
+      for (int steps{2000}; steps >= 125; steps /= 2) {
+        if (integrator == Integrator::euler && steps == 2000) {
+          smallest = steps; // that's the reference itself
+          continue;
+        }
+        Parameters pars{default_parameters(steps)};
+        pars.set_integrator()    = integrator;
+        pars.set_swept_capture() = swept;
+        Batch const batch{run_batch(pars, sims)};
+        print_batch(name + capture + std::to_string(steps), batch, reference);
+        double const p{ks_p_value(
+            ks_statistic(batch.counts, reference.counts), sims, sims)};
+        double const z{paired_z(batch, reference)};
+        std::cout << std::setw(28) << "" << "KS p-value: "
+                  << std::setprecision(3) << p << '\n';
+        if (p < .05 || std::abs(z) > 2.) {
+          break;
+        }
+        smallest = steps;
+      }
+      std::cout << "=> " << name << capture
+                << "smallest indistinguishable steps: "
+                << ((smallest != 0) ? std::to_string(smallest) : "none")
+                << "\n\n";
+    }
+  }
+}
+
+// steps and run time of adaptive steps, for discrete and swept capture
+void adaptive(int sims)
+{
+  for (bool swept : {false, true}) {
+    Parameters pars{default_parameters(2000)};
+    pars.set_swept_capture() = swept;
+    std::string const capture{swept ? "swept" : "discrete"};
+    Batch const reference{run_batch(pars, sims)};
+    print_batch("fixed " + capture + " (ref)", reference, reference);
+    pars.set_adaptive_steps() = true;
+    print_batch("adaptive " + capture, run_batch(pars, sims), reference);
+  }
+}
+
+// run time and cache misses of large flocks, with and without periodic
+// reordering along a Z-order curve. Steps are few, since every step costs
+// O(N^2) neighbour checks
+void reorder(int sims)
+{
+  Cache_misses misses;
+  for (int N_boids : {250, 1000}) {
+    Parameters pars{default_parameters(50, N_boids, 3)};
+    Batch reference{};
+    for (int interval : {0, 10, 1}) {
+      pars.set_reorder_interval() = interval;
+      misses.start();
+      Batch const batch{run_batch(pars, sims)};
+      long long const count{misses.stop()};
+      if (interval == 0) {
+        reference = batch;
+      }
+      print_batch("N " + std::to_string(N_boids) + " reorder "
+                      + ((interval == 0) ? "never" : std::to_string(interval)),
+                  batch, reference);
+      std::cout << std::setw(28) << "" << "cache misses/sim: "
+                << ((count < 0) ? std::string{"n/a"}
+                                : std::to_string(count / sims))
+                << '\n';
+    }
+  }
+}
+
+// run time of the brute force and grid engines, and cost of keeping the grid
+// in sync: boids crossing cells per step and full rebuilds. Neighbour distance
+// is 5 (1/20 of the box), so that a query only visits a few cells
+void grid(int sims)
+{
+  for (int N_boids : {500, 2000}) {
+    Parameters pars{300., 5., 1., .7, .045, .8, 80., .05, 2., 20, 10, 20,
+                    N_boids, 3};
+    Batch const reference{run_batch(pars, sims)};
+    print_batch("N " + std::to_string(N_boids) + " brute force", reference,
+                reference);
+    pars.set_engine() = Engine::grid;
+    Batch const batch{run_batch(pars, sims)};
+    print_batch("N " + std::to_string(N_boids) + " grid", batch, reference);
+    double crossings{0.};
+    double rebuilds{0.};
+    for (int i{0}; i != sims; ++i) {
+      std::vector<Boid> boids{};
+      Flock flock{fill(boids, pars, 2024u, i)};
+      add_predators(flock, pars, 2024u, i);
+      for (int step{0}; step != pars.get_steps(); ++step) {
+        flock.evolve(pars);
+        crossings += flock.grid().crossings();
+      }
+      rebuilds += flock.grid().rebuilds() - 1; // first build is not a fallback
+    }
+    std::cout << std::setw(28) << "" << "crossings/step: "
+              << std::setprecision(1) << crossings / (sims * pars.get_steps())
+              << "  fallback rebuilds/sim: " << rebuilds / sims << '\n';
+  }
+}
+
+// run time of the three engines on uniform and clustered initial conditions.
+// Engines select the same neighbours, so the counts of the three coincide
+void quadtree(int sims)
+{
+  std::array<std::pair<Engine, std::string>, 3> const engines{
+      {{Engine::brute_force, "brute force"},
+       {Engine::grid, "grid"},
+       {Engine::quadtree, "quadtree"}}};
+  for (bool clustered : {false, true}) {
+    std::string const initial{clustered ? " clustered " : " uniform "};
+    Parameters pars{300., 5., 1., .7, .045, .8, 80., .05, 2., 20, 10, 20,
+                    2000, 3};
+    Batch reference{};
+    for (auto const& [engine, name] : engines) {
+      pars.set_engine() = engine;
+      Batch const batch{run_batch(pars, sims, 2024u, clustered)};
+      if (engine == Engine::brute_force) {
+        reference = batch;
+      }
+      print_batch("N 2000" + initial + name, batch, reference);
+    }
+  }
+}
+
+// run time of the grid and quadtree engines with and without view culling, for
+// narrow to wide fields of view, and boids the neighbour queries check (the
+// candidates) once the flock has evolved. Culling skips regions, not boids a
+// query would select, so the counts coincide
+void cone(int sims)
+{
+  std::array<std::pair<Engine, std::string>, 2> const engines{
+      {{Engine::grid, "grid"}, {Engine::quadtree, "quadtree"}}};
+  for (int angle : {90, 180, 300}) {
+    Parameters pars{static_cast<double>(angle), 5., 1., .7, .045, .8, 80., .05,
+                    2., 20, 10, 20, 2000, 3};
+    for (auto const& [engine, name] : engines) {
+      std::string const label{"angle " + std::to_string(angle) + " " + name};
+      pars.set_engine()       = engine;
+      pars.set_view_culling() = false;
+      Batch const reference{run_batch(pars, sims)};
+      print_batch(label, reference, reference);
+      pars.set_view_culling() = true;
+      print_batch(label + " culled", run_batch(pars, sims), reference);
+    }
+    pars.set_engine() = Engine::grid;
+    std::vector<Boid> boids{};
+    Flock flock{fill(boids, pars, 2024u)};
+    add_predators(flock, pars, 2024u);
+    for (int step{0}; step != pars.get_steps(); ++step) {
+      flock.evolve(pars);
+    }
+    Quadtree tree;
+    tree.build(flock.state(), pars);
+    // candidates per query without and with culling, for grid and quadtree
+    std::array<double, 4> candidates{};
+    for (Boid const& boid : flock.state()) {
+      View_cone const cone{boid, pars.get_angle()};
+      auto const keep{[&](double x0, double y0, double x1, double y1) {
+        return cone.may_see(x0, y0, x1, y1);
+      }};
+      Position const p{boid.position()};
+      flock.grid().for_each_near(p, pars.get_d(),
+                                 [&](int) { ++candidates[0]; });
+      flock.grid().for_each_near(
+          p, pars.get_d(), [&](int) { ++candidates[1]; }, keep);
+      tree.for_each_near(p, pars.get_d(), [&](int) { ++candidates[2]; });
+      tree.for_each_near(p, pars.get_d(), [&](int) { ++candidates[3]; }, keep);
+    }
+    std::cout << std::setw(28) << "" << "candidates/query: grid "
+              << std::setprecision(1) << candidates[0] / flock.size()
+              << " -> " << candidates[1] / flock.size() << ", quadtree "
+              << candidates[2] / flock.size() << " -> "
+              << candidates[3] / flock.size() << '\n';
+  }
+}
+
+// run time of large flocks with cohesion and alignment from far-field sums,
+// against the exact rules through the grid, and the error of the two rules
+// together on an evolved flock: mean deviation from the exact ones relative to
+// their mean magnitude, and largest deviation relative to that mean
+void farfield(int sims)
+{
+  for (int N_boids : {2000, 8000}) {
+    Parameters pars{300., 35., 3.5, .7, .045, .8, 80., .05, 2., 10, 5, 10,
+                    N_boids, 3};
+    pars.set_engine() = Engine::grid;
+    std::string const size{"N " + std::to_string(N_boids)};
+    Batch const reference{run_batch(pars, sims)};
+    print_batch(size + " exact", reference, reference);
+    for (double tolerance : {0., .05, .1, .2}) {
+      Parameters far_pars{pars};
+      far_pars.set_far_field()           = true;
+      far_pars.set_far_field_tolerance() = tolerance;
+      std::ostringstream label;
+      label << size << " far field " << std::setprecision(2) << tolerance;
+      print_batch(label.str(), run_batch(far_pars, sims), reference);
+      std::vector<Boid> boids{};
+      Flock flock{fill(boids, far_pars, 2024u)};
+      add_predators(flock, far_pars, 2024u);
+      for (int step{0}; step != far_pars.get_steps(); ++step) {
+        flock.evolve(far_pars);
+      }
+      double magnitude{0.};
+      double deviation{0.};
+      double largest{0.};
+      int regulars{0};
+      for (Boid const& boid : flock.state()) {
+        if (boid.is_pred()) {
+          continue;
+        }
+        Velocity const exact{alignment(boid, flock, pars)
+                             + cohesion(boid, flock, pars)};
+        Velocity const approx{alignment(boid, flock, far_pars)
+                              + cohesion(boid, flock, far_pars)};
+        magnitude += norm(exact);
+        deviation += norm(approx - exact);
+        largest = std::max(largest, norm(approx - exact));
+        ++regulars;
+      }
+      magnitude /= regulars;
+      std::cout << std::setw(28) << "" << "relative error: mean "
+                << std::scientific << std::setprecision(1)
+                << deviation / regulars / magnitude << "  max "
+                << largest / magnitude << std::fixed << '\n';
+    }
+  }
+}
+
+// run time of every engine from small to large flocks with the default
+// neighbour distance, and the engine the automatic selection settles on
+void engines(int sims)
+{
+  std::array<std::pair<Engine, std::string>, 5> const engines{
+      {{Engine::brute_force, "brute force"},
+       {Engine::tiled, "tiled"},
+       {Engine::grid, "grid"},
+       {Engine::quadtree, "quadtree"},
+       {Engine::automatic, "automatic"}}};
+  for (int N_boids : {120, 500, 2000}) {
+    Parameters pars{default_parameters(50, N_boids, 3)};
+    Batch reference{};
+    for (auto const& [engine, name] : engines) {
+      pars.set_engine() = engine;
+      Batch const batch{run_batch(pars, sims)};
+      if (engine == Engine::brute_force) {
+        reference = batch;
+      }
+      print_batch("N " + std::to_string(N_boids) + " " + name, batch,
+                  reference);
+    }
+    std::vector<Boid> boids{};
+    Flock flock{fill(boids, pars, 2024u)};
+    add_predators(flock, pars, 2024u);
+    for (int step{0}; step != pars.get_steps(); ++step) {
+      flock.evolve(pars);
+    }
+    auto const selected{std::find_if(
+        engines.begin(), engines.end(),
+        [&](auto const& engine) { return engine.first == flock.engine(); })};
+    std::cout << std::setw(28) << "" << "selected: " << selected->second
+              << '\n';
+  }
+}
+
+// run time of main.cpp's default flocks, one at a time through the brute
+// force and tiled engines, and in lock-step batches of 4, 8 and 16 flocks
+void lockstep(int sims)
+{
+  Parameters pars{default_parameters(2000)};
+  Batch const reference{run_batch(pars, sims)};
+  print_batch("one at a time, brute force", reference, reference);
+  pars.set_engine() = Engine::tiled;
+  print_batch("one at a time, tiled", run_batch(pars, sims), reference);
+  for (int lanes : {4, 8, 16}) {
+    Batch batch{{}, 0., 0.};
+    auto const start{std::chrono::steady_clock::now()};
+    for (int first{0}; first < sims; first += lanes) {
+      std::vector<Flock> flocks;
+      for (int i{first}; i != std::min(first + lanes, sims); ++i) {
+        std::vector<Boid> boids{};
+        Flock flock{fill(boids, pars, 2024u, i)};
+        add_predators(flock, pars, 2024u, i);
+        flocks.push_back(flock);
+      }
+      Lockstep group{flocks, pars};
+      batch.steps += group.simulate() * group.size();
+      for (Flock const& flock : group.flocks()) {
+        batch.counts.push_back(flock.counter());
+      }
+    }
+    batch.seconds = seconds_since(start) / sims;
+    batch.steps /= sims;
+    print_batch("lock-step, " + std::to_string(lanes) + " lanes", batch,
+                reference);
+  }
+}
+
+// capture statistics and run time of simulations starting from flocks that
+// have already formed (see warm_start), against cold starts from random
+// positions. Formation is paid once per formed flock: its cost is spread over
+// the simulations sharing it. A flock formed without predators may be tighter
+// than one formed while chased, and simulations sharing a formed flock are
+// correlated: z and the KS test tell whether counts shift
+void warm(int sims)
+{
+  Parameters const pars{default_parameters(2000)};
+  Batch const reference{run_batch(pars, sims)};
+  print_batch("cold start (ref)", reference, reference);
+  for (int formation : {500, 1000}) {
+    for (int snapshots : {1, 10}) {
+      Batch batch{{}, 0., 0.};
+      auto const start{std::chrono::steady_clock::now()};
+      std::vector<std::vector<Boid>> formed{};
+      for (int k{0}; k != std::min(snapshots, sims); ++k) {
+        formed.push_back(warm_start(pars, 2024u, k, formation));
+      }
+      for (int i{0}; i != sims; ++i) {
+        Flock flock{formed[i % formed.size()]};
+        add_predators(flock, pars, 2024u, i);
+        batch.steps += simulate(flock, pars);
+        batch.counts.push_back(flock.counter());
+      }
+      batch.seconds = seconds_since(start) / sims;
+      batch.steps /= sims;
+      print_batch("formed " + std::to_string(formation) + ", "
+                      + std::to_string(snapshots) + " snapshot(s)",
+                  batch, reference);
+      std::cout << std::setw(28) << "" << "KS p-value: "
+                << std::setprecision(3)
+                << ks_p_value(ks_statistic(batch.counts, reference.counts),
+                              sims, sims)
+                << '\n';
+    }
+  }
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+  std::map<std::string, std::function<void(int)>> const benchmarks{
+      {"adaptive", adaptive},
+      {"capture", capture},
+      {"cone", cone},
+      {"engines", engines},
+      {"farfield", farfield},
+      {"grid", grid},
+      {"integrators", integrators},
+      {"lockstep", lockstep},
+      {"quadtree", quadtree},
+      {"reorder", reorder},
+      {"warm", warm}};
+
+  if (argc < 2 || benchmarks.count(argv[1]) == 0) {
+    std::cerr << "Usage: bench <benchmark> [simulations]\nBenchmarks:";
+    for (auto const& benchmark : benchmarks) {
+      std::cerr << ' ' << benchmark.first;
+    }
+    std::cerr << '\n';
+    return EXIT_FAILURE;
+  }
+  int const sims{(argc > 2) ? std::atoi(argv[2]) : 10};
+  if (sims < 2) {
+    std::cerr << "At least 2 simulations are needed\n";
+    return EXIT_FAILURE;
+  }
+  benchmarks.at(argv[1])(sims);
+}
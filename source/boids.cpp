@@ -97,6 +97,92 @@ bool is_seen(Boid const& b1, Boid const& b2, double angle_of_view)
   }
 }
 
+View_cone::View_cone(Boid const& viewer, double angle_of_view)
+    : apex_{viewer.position()}
+    , axis_{viewer.velocity()}
+    , wide_{angle_of_view > 180.}
+    , full_{angle_of_view >= 360.}
+{
+  // a wide cone is culled through its complement, the wedge of half-angle
+  // π - half around the opposite of the velocity
+  double const half{pi * angle_of_view / 360.};
+  double const beta{wide_ ? pi - half : half};
+  double const sign{wide_ ? -1. : 1.};
+  double const c{std::cos(beta)};
+  double const s{std::sin(beta)};
+  double const ax{sign * axis_.x()};
+  double const ay{sign * axis_.y()};
+  left_  = {c * ax - s * ay, s * ax + c * ay};
+  right_ = {c * ax + s * ay, -s * ax + c * ay};
+}
+
+// corners are tested against the boundaries of the wedge with a relative
+// margin well above rounding, so that a boid on the edge of the field of view
+// is never culled. A box outside a narrow cone is only found if it lies
+// entirely beyond one of its boundaries or entirely behind the boid: boxes
+// straddling the blind region are searched anyway
+bool View_cone::may_see(double x0, double y0, double x1, double y1) const
+{
+  if (full_) {
+    return true;
+  }
+  double const xs[2]{x0 - apex_.x(), x1 - apex_.x()};
+  double const ys[2]{y0 - apex_.y(), y1 - apex_.y()};
+  double const v_scale{std::abs(axis_.x()) + std::abs(axis_.y())};
+  // counts of corners surely beyond the right boundary, the left one and
+  // behind the boid (for wide cones, surely within the blind wedge)
+  int beyond_right{0};
+  int beyond_left{0};
+  int behind{0};
+  for (double dx : xs) {
+    for (double dy : ys) {
+      double const margin{1e-9 * (std::abs(dx) + std::abs(dy)) * v_scale};
+      double const cross_right{right_.x() * dy - right_.y() * dx};
+      double const cross_left{dx * left_.y() - dy * left_.x()};
+      if (wide_) {
+        behind += (cross_right > margin && cross_left > margin);
+      } else {
+        beyond_right += (cross_right < -margin);
+        beyond_left += (cross_left < -margin);
+        behind += (dx * axis_.x() + dy * axis_.y() < -margin);
+      }
+    }
+  }
+  return beyond_right != 4 && beyond_left != 4 && behind != 4;
+}
+
+// the converse of may_see: a narrow cone sees a box if it holds all its
+// corners, a wide one if the box lies entirely beyond a boundary of the blind
+// wedge or in front of the boid
+bool View_cone::sees_all(double x0, double y0, double x1, double y1) const
+{
+  if (full_) {
+    return true;
+  }
+  double const xs[2]{x0 - apex_.x(), x1 - apex_.x()};
+  double const ys[2]{y0 - apex_.y(), y1 - apex_.y()};
+  double const v_scale{std::abs(axis_.x()) + std::abs(axis_.y())};
+  int within{0};
+  int beyond_right{0};
+  int beyond_left{0};
+  int in_front{0};
+  for (double dx : xs) {
+    for (double dy : ys) {
+      double const margin{1e-9 * (std::abs(dx) + std::abs(dy)) * v_scale};
+      double const cross_right{right_.x() * dy - right_.y() * dx};
+      double const cross_left{dx * left_.y() - dy * left_.x()};
+      if (wide_) {
+        beyond_right += (cross_right < -margin);
+        beyond_left += (cross_left < -margin);
+        in_front += (dx * axis_.x() + dy * axis_.y() > margin);
+      } else {
+        within += (cross_right > margin && cross_left > margin);
+      }
+    }
+  }
+  return within == 4 || beyond_right == 4 || beyond_left == 4 || in_front == 4;
+}
+
 // auxiliary function returning true if boid is in one of the 4 corners
 bool in_corner(Boid const& boid, double x_max, double y_max)
 {
@@ -157,3 +243,38 @@ Velocity& bound_position(Boid& boid, double x_min, double x_max, double y_min,
   }
   return boid.velocity();
 }
+
+// maps v into [min, max), as on a circle of length max - min. Rounding may
+// leave v on max, or just below min: such values are mapped to min
+double wrap(double v, double min, double max)
+{
+  double const length{max - min};
+  v -= length * std::floor((v - min) / length);
+  return (v < min || v >= max) ? min : v;
+}
+
+// in a periodic world boids leaving the box through a border re-enter it
+// through the opposite one, instead of being steered back by bound_position
+Position& wrap_position(Boid& boid, double x_min, double x_max, double y_min,
+                        double y_max)
+{
+  boid.position() = {wrap(boid.position().x(), x_min, x_max),
+                     wrap(boid.position().y(), y_min, y_max)};
+  return boid.position();
+}
+
+// copy of boid moved by whole box sides to the image closest to p (minimum
+// image convention), for boids in a periodic world. A boid already closer than
+// half a side to p along both axes is copied unchanged
+Boid nearest_image(Boid const& boid, Position const& p, double x_min,
+                   double x_max, double y_min, double y_max)
+{
+  double const width{x_max - x_min};
+  double const height{y_max - y_min};
+  Boid image{boid};
+  image.position().x() -=
+      width * std::round((boid.position().x() - p.x()) / width);
+  image.position().y() -=
+      height * std::round((boid.position().y() - p.y()) / height);
+  return image;
+}
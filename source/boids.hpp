@@ -31,6 +31,13 @@ inline double norm(Vector2D const& vector)
 {
   return std::sqrt(vector.x() * vector.x() + vector.y() * vector.y());
 }
+// to compare distances without square roots
+inline double squared_distance(Vector2D const& p1, Vector2D const& p2)
+{
+  double const xdiff{p1.x() - p2.x()};
+  double const ydiff{p1.y() - p2.y()};
+  return xdiff * xdiff + ydiff * ydiff;
+}
 
 template<class T>
 T operator+(T const& v1, T const& v2)
@@ -99,6 +106,25 @@ double distance(Boid const& b1, Boid const& b2);
 
 bool is_seen(Boid const& b1, Boid const& b2, double angle_of_view);
 
+// the field of view of a boid, used to skip whole regions of space in spatial
+// queries. may_see is false only if no point of the box [x0, x1] x [y0, y1]
+// can be seen (see is_seen), so skipping the boids in such boxes never changes
+// a selection; sees_all is true only if every point of the box can be seen
+class View_cone
+{
+  Position apex_;
+  Velocity axis_;
+  Vector2D left_;  // boundaries of the cone, if it is at most a half-plane,
+  Vector2D right_; // of the blind wedge behind the boid otherwise
+  bool wide_;      // wider than a half-plane
+  bool full_;      // the whole plane
+
+ public:
+  explicit View_cone(Boid const& viewer, double angle_of_view);
+  bool may_see(double x0, double y0, double x1, double y1) const;
+  bool sees_all(double x0, double y0, double x1, double y1) const;
+};
+
 bool in_corner(Boid const& boid, double x_max, double y_max);
 
 void leave_corner(Boid& boid, double x_min, double x_max, double y_min,
@@ -107,4 +133,12 @@ void leave_corner(Boid& boid, double x_min, double x_max, double y_min,
 Velocity& bound_position(Boid& b, double x_min, double x_max, double y_min,
                          double y_max);
 
+double wrap(double v, double min, double max);
+
+Position& wrap_position(Boid& boid, double x_min, double x_max, double y_min,
+                        double y_max);
+
+Boid nearest_image(Boid const& boid, Position const& p, double x_min,
+                   double x_max, double y_min, double y_max);
+
 #endif
@@ -179,6 +179,57 @@ TEST_CASE("Testing Boid")
     CHECK(is_seen(b7, b5, 90.) == false);
     CHECK(is_seen(b7, b6, 90.) == false);
   }
+  SUBCASE("testing view cone")
+  {
+    Boid const viewer{Position{}, Velocity{2., 0.}};
+    View_cone const narrow{viewer, 90.};
+    CHECK(narrow.may_see(1., -.5, 2., .5));
+    CHECK_FALSE(narrow.may_see(1., 3., 2., 4.));   // beyond the left boundary
+    CHECK_FALSE(narrow.may_see(1., -4., 2., -3.)); // beyond the right one
+    CHECK_FALSE(narrow.may_see(-2., -1., -1., 1.)); // behind
+    CHECK(narrow.may_see(-1., -1., 1., 1.));        // holding the viewer
+    CHECK(narrow.may_see(1., 1., 2., 2.)); // corner on the boundary
+    View_cone const wide{viewer, 300.};
+    CHECK_FALSE(wide.may_see(-3., -.5, -2., .5)); // within the blind wedge
+    CHECK(wide.may_see(-3., 1., -2., 2.));
+    CHECK(wide.may_see(-1., -1., 1., 1.));
+    CHECK(View_cone{viewer, 360.}.may_see(-3., -.5, -2., .5));
+    CHECK(narrow.sees_all(2., -.5, 3., .5));
+    CHECK_FALSE(narrow.sees_all(1., 0., 2., 2.)); // crossing the boundary
+    CHECK_FALSE(narrow.sees_all(-1., -1., 1., 1.));
+    CHECK(wide.sees_all(-3., 2., -2., 3.));
+    CHECK(wide.sees_all(1., -4., 2., 4.));
+    CHECK_FALSE(wide.sees_all(-3., -1., -2., 1.)); // crossing the blind wedge
+    CHECK_FALSE(wide.sees_all(-1., -1., 1., 1.));
+    // boxes on a lattice around the viewer: a box is culled only if none of a
+    // lattice of its points (corners and edges included) is seen, and seen
+    // whole only if all of them are
+    for (double angle : {30., 90., 180., 270., 300.}) {
+      View_cone const cone{viewer, angle};
+      int culled{0};
+      for (double x0{-3.}; x0 < 3.; x0 += .75) {
+        for (double y0{-3.}; y0 < 3.; y0 += .75) {
+          bool seen{false};
+          bool all_seen{true};
+          for (int i{0}; i != 5; ++i) {
+            for (int j{0}; j != 5; ++j) {
+              Boid const b{Position{x0 + .25 * i, y0 + .25 * j}, Velocity{}};
+              seen     = seen || is_seen(viewer, b, angle);
+              all_seen = all_seen && is_seen(viewer, b, angle);
+            }
+          }
+          if (seen) {
+            CHECK(cone.may_see(x0, y0, x0 + 1., y0 + 1.));
+          }
+          if (!all_seen) {
+            CHECK_FALSE(cone.sees_all(x0, y0, x0 + 1., y0 + 1.));
+          }
+          culled += !cone.may_see(x0, y0, x0 + 1., y0 + 1.);
+        }
+      }
+      CHECK(culled > 0);
+    }
+  }
 }
 TEST_CASE("Testing behavior in corners' proximity")
 {
@@ -281,4 +332,24 @@ TEST_CASE("Testing behavior in corners' proximity")
     CHECK(bound_position(b6, xmin, xmax, ymin, ymax) // positioned in the center
           == v2);
   }
-}
\ No newline at end of file
+
+  SUBCASE("testing periodic borders")
+  {
+    CHECK(wrap(101.5, 0., 100.) == doctest::Approx(1.5));
+    CHECK(wrap(-.5, 0., 100.) == doctest::Approx(99.5));
+    CHECK(wrap(42., 0., 100.) == 42.);
+    CHECK(wrap(100., 0., 100.) == 0.);
+    CHECK(wrap(-1e-17, 0., 100.) == 0.); // rounds to 100
+    Boid b{{-2., 104.}, {1., 1.}};
+    CHECK(wrap_position(b, 0., 100., 0., 100.) == Position{98., 4.});
+    CHECK(b.velocity() == Velocity{1., 1.});
+    // across one border, across a corner, already the nearest
+    Boid const image{nearest_image(b, {10., 50.}, 0., 100., 0., 100.)};
+    CHECK(image.position() == Position{-2., 4.});
+    CHECK(image.velocity() == b.velocity());
+    CHECK(nearest_image(b, {5., 95.}, 0., 100., 0., 100.).position()
+          == Position{-2., 104.});
+    CHECK(nearest_image(b, {80., 20.}, 0., 100., 0., 100.).position()
+          == b.position());
+  }
+}
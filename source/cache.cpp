@@ -0,0 +1,126 @@
+#include "cache.hpp"
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+// defines Result_cache's key, lookup and storage
+
+std::uint64_t fnv1a(std::string const& text)
+{
+  std::uint64_t hash{14695981039346656037ull};
+  for (unsigned char c : text) {
+    hash ^= c;
+    hash *= 1099511628211ull;
+  }
+  return hash;
+}
+
+Result_cache::Result_cache(std::string dir)
+    : dir_{std::move(dir)}
+{
+  std::error_code error{};
+  std::filesystem::create_directories(dir_, error);
+  if (error || !std::filesystem::is_directory(dir_)) {
+    throw std::ios_base::failure{"ERROR: Cannot create cache directory "
+                                 + dir_ + '\n'};
+  }
+}
+
+// the fields of pars the outcome depends on, doubles in hexadecimal so that
+// the text identifies them bit for bit, and the scheme of the random numbers
+// (see fill and add_predators): one Philox stream per (seed, simulation) and
+// kind of boid. Prescale (printing only), the engine and view culling (ways
+// of finding the same boids) are left out, so that switching them keeps the
+// results cached
+std::string Result_cache::key(Parameters const& pars, unsigned int seed,
+                              std::string const& variant)
+{
+  std::ostringstream os;
+  os << std::hexfloat << "engine " << engine_version
+     << " random philox4x32-10/seed,simulation,stream seed " << seed
+     << " variant " << variant << " angle " << pars.get_angle() << " d "
+     << pars.get_d() << " d_s " << pars.get_d_s() << " s " << pars.get_s()
+     << " c " << pars.get_c() << " a " << pars.get_a() << " max_speed "
+     << pars.get_max_speed() << " min_speed " << pars.get_min_speed()
+     << " duration " << pars.get_duration() << " steps " << pars.get_steps()
+     << " N_boids " << pars.get_N_boids() << " N_preds " << pars.get_N_preds()
+     << " d_s_pred " << pars.get_d_s_pred() << " s_pred "
+     << pars.get_s_pred() << " pred_rules " << pars.get_pred_angle() << ' '
+     << pars.get_pred_d_s() << ' ' << pars.get_pred_s() << ' '
+     << pars.get_pred_c() << " seek_type " << pars.get_seek_type() << " box "
+     << pars.get_x_min() << ' ' << pars.get_x_max() << ' ' << pars.get_y_min()
+     << ' ' << pars.get_y_max() << " swept " << pars.get_swept_capture()
+     << " integrator " << static_cast<int>(pars.get_integrator())
+     << " adaptive " << pars.get_adaptive_steps() << " reorder "
+     << pars.get_reorder_interval() << " far_field " << pars.get_far_field()
+     << ' ' << pars.get_far_field_tolerance() << " periodic "
+     << pars.get_periodic();
+  return os.str();
+}
+
+std::string Result_cache::path(std::string const& key) const
+{
+  std::ostringstream name;
+  name << std::hex << std::setw(16) << std::setfill('0') << fnv1a(key)
+       << ".txt";
+  return (std::filesystem::path{dir_} / name.str()).string();
+}
+
+// file format: the key on the first line, then "simulation counter steps"
+// lines (a simulation stored twice keeps its last line)
+Result_cache::Batch& Result_cache::load(std::string const& key)
+{
+  auto const found{batches_.find(key)};
+  if (found != batches_.end()) {
+    return found->second;
+  }
+  Batch& batch{batches_[key]};
+  std::ifstream is{path(key)};
+  if (!is) {
+    return batch; // nothing stored yet
+  }
+  std::string first{};
+  std::getline(is, first);
+  if (first != key) {
+    batch.usable = false;
+    return batch;
+  }
+  int simulation{0};
+  Result result{};
+  while (is >> simulation >> result.counter >> result.steps) {
+    batch.results[simulation] = result;
+  }
+  return batch;
+}
+
+std::optional<Result_cache::Result> Result_cache::find(std::string const& key,
+                                                      int simulation)
+{
+  Batch const& batch{load(key)};
+  auto const found{batch.results.find(simulation)};
+  if (!batch.usable || found == batch.results.end()) {
+    return std::nullopt;
+  }
+  return found->second;
+}
+
+void Result_cache::store(std::string const& key, int simulation,
+                         Result result)
+{
+  Batch& batch{load(key)};
+  if (!batch.usable) {
+    return;
+  }
+  bool const fresh{!std::filesystem::exists(path(key))};
+  std::ofstream os{path(key), std::ios::app};
+  if (!os) {
+    throw std::ios_base::failure{"ERROR: Cannot write cache file "
+                                 + path(key) + '\n'};
+  }
+  if (fresh) {
+    os << key << '\n';
+  }
+  os << simulation << ' ' << result.counter << ' ' << result.steps << '\n';
+  batch.results[simulation] = result;
+}
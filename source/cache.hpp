@@ -0,0 +1,61 @@
+#ifndef CACHE_HPP
+#define CACHE_HPP
+
+#include "parameters.hpp"
+#include <cstdint>
+#include <map>
+#include <optional>
+#include <string>
+
+// defines Result_cache, an on-disk store of the outcomes of simulations
+
+// version of the simulation code, part of every key: it must be increased by
+// any change altering the outcome of simulations (rules, integration, random
+// streams, ...), so that results computed by older code are no longer found
+constexpr int engine_version{2};
+
+// outcomes of the simulations of a directory, one file per batch. A batch is
+// identified by its key, the canonical text of everything the outcome of its
+// simulations depends on but their index; the file is named after the key's
+// hash and starts with the key itself, so that batches whose keys collide are
+// told apart (the second one is not cached). Results are appended to the file
+// as they are stored, so an interrupted run keeps the simulations it finished
+class Result_cache
+{
+ public:
+  struct Result
+  {
+    int counter; // preys eaten
+    int steps;   // steps performed
+  };
+
+ private:
+  std::string dir_;
+  struct Batch
+  {
+    bool usable{true}; // false if the file belongs to another key
+    std::map<int, Result> results;
+  };
+  std::map<std::string, Batch> batches_; // loaded so far, by key
+  std::string path(std::string const& key) const;
+  Batch& load(std::string const& key);
+
+ public:
+  // creates dir if it does not exist. Throws std::ios_base::failure if it
+  // cannot be created
+  explicit Result_cache(std::string dir);
+  // key of the batch of simulations run with pars from seed. Variant tells
+  // apart batches of the same parameters started or stepped differently (e.g.
+  // warm starts), whose outcomes differ
+  static std::string key(Parameters const& pars, unsigned int seed,
+                         std::string const& variant);
+  // result of the [simulation]-th simulation of the batch, if stored
+  std::optional<Result> find(std::string const& key, int simulation);
+  // throws std::ios_base::failure if the file cannot be written
+  void store(std::string const& key, int simulation, Result result);
+};
+
+// 64-bit FNV-1a hash of text
+std::uint64_t fnv1a(std::string const& text);
+
+#endif
@@ -0,0 +1,86 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "cache.hpp"
+#include "doctest.h"
+#include <filesystem>
+#include <fstream>
+
+TEST_CASE("Testing the result cache")
+{
+  auto const dir{std::filesystem::temp_directory_path() / "boids-cache.t"};
+  std::filesystem::remove_all(dir);
+  Parameters const pars{300., 35., 3.5, .7,  .045, .8, 80., .05,
+                        30.,  300, 40,  300, 60,   2,  1};
+  std::string const key{Result_cache::key(pars, 7u, "cold")};
+
+  SUBCASE("results are found again, also by another cache")
+  {
+    Result_cache cache{dir.string()};
+    CHECK_FALSE(cache.find(key, 3).has_value());
+    cache.store(key, 3, {12, 300});
+    cache.store(key, 0, {5, 290});
+    REQUIRE(cache.find(key, 3).has_value());
+    CHECK(cache.find(key, 3)->counter == 12);
+    CHECK(cache.find(key, 3)->steps == 300);
+    CHECK_FALSE(cache.find(key, 1).has_value());
+
+    Result_cache reopened{dir.string()};
+    REQUIRE(reopened.find(key, 0).has_value());
+    CHECK(reopened.find(key, 0)->counter == 5);
+    CHECK(reopened.find(key, 0)->steps == 290);
+    CHECK(reopened.find(key, 3)->counter == 12);
+  }
+
+  SUBCASE("keys tell apart everything the outcome depends on")
+  {
+    Parameters swept{pars};
+    swept.set_swept_capture() = true;
+    Parameters seek{pars};
+    seek.set_seek_type() = 2;
+    Parameters const nearby{std::nextafter(300., 0.), 35., 3.5, .7, .045, .8,
+                            80., .05, 30., 300, 40, 300, 60, 2, 1};
+    CHECK(Result_cache::key(pars, 7u, "cold") == key);
+    CHECK(Result_cache::key(pars, 8u, "cold") != key);
+    CHECK(Result_cache::key(pars, 7u, "warm 100 1") != key);
+    CHECK(Result_cache::key(swept, 7u, "cold") != key);
+    CHECK(Result_cache::key(seek, 7u, "cold") != key);
+    // doubles are written exactly
+    CHECK(Result_cache::key(nearby, 7u, "cold") != key);
+    CHECK(key.find("engine " + std::to_string(engine_version) + ' ')
+          != std::string::npos);
+    // but not on how the boids are found
+    Parameters engine{pars};
+    engine.set_engine()       = Engine::grid;
+    engine.set_view_culling() = false;
+    CHECK(Result_cache::key(engine, 7u, "cold") == key);
+
+    Result_cache cache{dir.string()};
+    cache.store(key, 0, {5, 300});
+    CHECK_FALSE(
+        cache.find(Result_cache::key(swept, 7u, "cold"), 0).has_value());
+  }
+
+  SUBCASE("a file holding another key is not used")
+  {
+    Result_cache cache{dir.string()};
+    cache.store(key, 0, {5, 300});
+    // overwrites the file with the results of a colliding key
+    std::filesystem::path file{};
+    for (auto const& entry : std::filesystem::directory_iterator{dir}) {
+      file = entry.path();
+    }
+    std::ofstream{file} << "another key\n0 9 300\n";
+    Result_cache reopened{dir.string()};
+    CHECK_FALSE(reopened.find(key, 0).has_value());
+    reopened.store(key, 1, {6, 300});
+    CHECK_FALSE(reopened.find(key, 1).has_value());
+  }
+
+  SUBCASE("testing fnv1a")
+  {
+    // reference values of the 64-bit FNV-1a hash
+    CHECK(fnv1a("") == 0xcbf29ce484222325ull);
+    CHECK(fnv1a("a") == 0xaf63dc4c8601ec8cull);
+  }
+
+  std::filesystem::remove_all(dir);
+}
@@ -0,0 +1,41 @@
+#include "capture_log.hpp"
+
+// defines Capture_log's methods
+
+Capture_log::Capture_log(int capacity, int steps)
+    : events_(capacity, Capture_event{0, 0, 0, {}, 0.})
+    , series_(steps, 0)
+{
+  assert(capacity > 0);
+  assert(steps >= 0);
+}
+
+void Capture_log::record(Capture_event const& event)
+{
+  // when the buffer is full, the oldest event is overwritten
+  events_[next_] = event;
+  // not risking narrowing since capacity is an int
+  next_ = (next_ + 1) % static_cast<int>(events_.size());
+  ++total_;
+}
+
+void Capture_log::end_step(int counter)
+{
+  // steps beyond the preallocated series are not recorded
+  if (steps_ < static_cast<int>(series_.size())) {
+    series_[steps_] = counter;
+    ++steps_;
+  }
+}
+
+std::vector<Capture_event> Capture_log::events() const
+{
+  int const capacity{static_cast<int>(events_.size())};
+  if (total_ < capacity) { // not full yet: events are in slots [0, total)
+    return {events_.begin(), events_.begin() + total_};
+  }
+  // once the buffer is full, the oldest event sits where the next one goes
+  std::vector<Capture_event> ordered{events_};
+  std::rotate(ordered.begin(), ordered.begin() + next_, ordered.end());
+  return ordered;
+}
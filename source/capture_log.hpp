@@ -0,0 +1,49 @@
+#ifndef CAPTURE_LOG_HPP
+#define CAPTURE_LOG_HPP
+
+#include "boids.hpp"
+#include <algorithm>
+#include <vector>
+
+// defines Capture_event and Capture_log, recording when, where and by whom
+// preys are captured during a simulation
+
+struct Capture_event
+{
+  int step;     // step (starting from 0) during which the capture happened
+  int predator; // id in the flock of the predator (see Flock::id)
+  int prey;     // id in the flock of the prey
+  // prey's position and predator-prey distance when captured: at the end of
+  // the step, or at the closest approach for a swept capture (see is_victim)
+  Position position;
+  double distance;
+};
+
+// ring buffer of capture events (when full, the oldest events are
+// overwritten) plus, optionally, the value of the flock's counter after each
+// step. All memory is allocated by the constructor (also copies are full-size):
+// recording never allocates
+class Capture_log
+{
+  std::vector<Capture_event> events_;
+  int next_{0};  // slot of events_ the next event is written to
+  int total_{0}; // events recorded, including the overwritten ones
+  std::vector<int> series_;
+  int steps_{0};  // steps recorded in series_
+
+ public:
+  // capacity is the number of events kept, steps the length of the series (0
+  // to disable it)
+  explicit Capture_log(int capacity, int steps = 0);
+  void record(Capture_event const& event);
+  void end_step(int counter);
+  // events kept, from the oldest to the most recent
+  std::vector<Capture_event> events() const;
+  // clang-format off
+  int total() const{return total_;}
+  int lost() const{return std::max(total_ - static_cast<int>(events_.size()), 0);}
+  std::vector<int> series() const{return {series_.begin(), series_.begin() + steps_};}
+  // clang-format on
+};
+
+#endif
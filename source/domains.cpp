@@ -0,0 +1,514 @@
+#include "domains.hpp"
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <type_traits>
+
+// defines the protocol between the calling process and the workers of
+// simulate_decomposed. Every step takes four rounds, in which each worker
+// sends its messages and then waits for the ones of the calling process (which
+// reads all the workers' messages before sending any, so none can deadlock):
+// 1. halo: boids within the halo of the strip's edges, and predators
+// 2. preys (only when seeking the nearest one): nearest visible prey of the
+//    strip for every predator, and the nearest overall for the strip's ones
+// 3. predators' new states, since they may capture preys of other strips
+// 4. migration: boids that left the strip, and captures of the strip's preys
+
+namespace {
+// state of a boid as sent between processes, with its index in the flock (id)
+struct Record
+{
+  int id;
+  bool is_pred;
+  bool is_eaten;
+  double x;
+  double y;
+  double v_x;
+  double v_y;
+};
+
+Record record(Boid const& b, int id)
+{
+  return {id,
+          b.is_pred(),
+          b.is_eaten(),
+          b.position().x(),
+          b.position().y(),
+          b.velocity().x(),
+          b.velocity().y()};
+}
+
+Boid boid(Record const& r)
+{
+  Position const p{r.x, r.y};
+  Velocity const v{r.v_x, r.v_y};
+  Boid b{r.is_pred ? Boid{p, v, true} : Boid{p, v}};
+  b.is_eaten() = r.is_eaten;
+  return b;
+}
+
+bool by_id(Record const& r1, Record const& r2)
+{
+  return r1.id < r2.id;
+}
+
+// nearest visible prey of a strip for a predator (d2 is infinite if none)
+struct Candidate
+{
+  int pred;
+  double d2;
+  Record prey;
+};
+
+// preys of a strip captured by a predator during a step
+struct Credit
+{
+  int pred;
+  int preys;
+};
+
+void write_all(int fd, void const* data, std::size_t bytes)
+{
+  char const* p{static_cast<char const*>(data)};
+  while (bytes > 0) {
+    ssize_t const n{::send(fd, p, bytes, MSG_NOSIGNAL)};
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n < 0) {
+      throw std::runtime_error{"decomposed simulation: connection lost"};
+    }
+    p += n;
+    bytes -= static_cast<std::size_t>(n);
+  }
+}
+
+void read_all(int fd, void* data, std::size_t bytes)
+{
+  char* p{static_cast<char*>(data)};
+  while (bytes > 0) {
+    ssize_t const n{::recv(fd, p, bytes, 0)};
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n <= 0) {
+      throw std::runtime_error{"decomposed simulation: connection lost"};
+    }
+    p += n;
+    bytes -= static_cast<std::size_t>(n);
+  }
+}
+
+// messages are vectors of trivially copyable items, preceded by their number
+template<class T>
+void send(int fd, std::vector<T> const& items)
+{
+  static_assert(std::is_trivially_copyable<T>::value);
+  std::uint64_t const n{items.size()};
+  write_all(fd, &n, sizeof n);
+  write_all(fd, items.data(), n * sizeof(T));
+}
+
+template<class T>
+std::vector<T>& receive(int fd, std::vector<T>& items)
+{
+  static_assert(std::is_trivially_copyable<T>::value);
+  std::uint64_t n;
+  read_all(fd, &n, sizeof n);
+  items.resize(n);
+  read_all(fd, items.data(), n * sizeof(T));
+  return items;
+}
+
+// the i-th strip spans [x_min + i * width, x_min + (i + 1) * width), the border
+// ones extending to the boids out of the box
+class Strips
+{
+  double x_min_;
+  double width_;
+  int n_;
+
+ public:
+  Strips(Parameters const& pars, int n)
+      : x_min_{pars.get_x_min()}
+      , width_{(pars.get_x_max() - pars.get_x_min()) / n}
+      , n_{n}
+  {}
+  int of(double x) const
+  {
+    return static_cast<int>(
+        std::clamp(std::floor((x - x_min_) / width_), 0., n_ - 1.));
+  }
+  double lo(int i) const
+  {
+    return (i == 0) ? -std::numeric_limits<double>::infinity()
+                    : x_min_ + i * width_;
+  }
+  double hi(int i) const
+  {
+    return (i == n_ - 1) ? std::numeric_limits<double>::infinity()
+                         : x_min_ + (i + 1) * width_;
+  }
+};
+
+// halo of the strips, widened to absorb the rounding of strip assignment
+double halo(Parameters const& pars)
+{
+  return ghost_reach(pars) * (1. + 1e-9);
+}
+
+// a worker keeps its boids in flock order. Its local flock holds them, the
+// halo, every predator and the preys they seek, in flock order too: the rules
+// select the same boids in the same order as in the whole flock, so their sums
+// are the same. The local flock is built anew at every step
+void work(int fd, int w, Parameters const& pars, Strips const& strips)
+{
+  double const d_t{pars.get_duration() / pars.get_steps()};
+  double const reach{halo(pars)};
+  std::vector<Record> owned;
+  std::vector<Record> band;
+  std::vector<Record> preds;
+  std::vector<Record> others;
+  std::vector<Record> all_preds;
+  std::vector<Record> local;
+  std::vector<Record> kept;
+  std::vector<Record> moved;
+  std::vector<Candidate> candidates;
+  std::vector<Credit> credits;
+  std::vector<char> mine;
+  std::vector<int> ids;
+  std::vector<Boid> boids;
+  receive(fd, owned);
+  for (int step{0}; step != pars.get_steps(); ++step) {
+    band.clear();
+    preds.clear();
+    local.clear();
+    for (Record const& r : owned) {
+      if (r.is_eaten) { // ignored by all rules
+        continue;
+      }
+      if (r.x - strips.lo(w) < reach || strips.hi(w) - r.x < reach) {
+        band.push_back(r);
+      }
+      if (r.is_pred) {
+        preds.push_back(r);
+      }
+      local.push_back(r);
+    }
+    send(fd, band);
+    send(fd, preds);
+    receive(fd, others);
+    receive(fd, all_preds);
+    local.insert(local.end(), others.begin(), others.end());
+    local.insert(local.end(), all_preds.begin(), all_preds.end());
+    if (pars.get_seek_type() == 0) {
+      // preys are compared as by find_prey: the first in flock order among
+      // equally near ones
+      candidates.clear();
+      for (Record const& p : all_preds) {
+        Boid const pred{boid(p)};
+        Candidate c{p.id, std::numeric_limits<double>::infinity(), {}};
+        for (Record const& r : owned) {
+          if (r.is_pred || r.is_eaten) {
+            continue;
+          }
+          Boid const prey{boid(r)};
+          double const d2{squared_distance(pred.position(), prey.position())};
+          if (d2 < c.d2 && is_seen(pred, prey, pars.get_pred_angle())) {
+            c.d2   = d2;
+            c.prey = r;
+          }
+        }
+        candidates.push_back(c);
+      }
+      send(fd, candidates);
+      for (Candidate const& c : receive(fd, candidates)) {
+        if (c.d2 != std::numeric_limits<double>::infinity()) {
+          local.push_back(c.prey);
+        }
+      }
+    }
+    std::sort(local.begin(), local.end(), by_id);
+    local.erase(std::unique(local.begin(), local.end(),
+                            [](Record const& r1, Record const& r2) {
+                              return r1.id == r2.id;
+                            }),
+                local.end());
+    boids.clear();
+    ids.clear();
+    mine.clear();
+    for (Record const& r : local) {
+      boids.push_back(boid(r));
+      ids.push_back(r.id);
+      mine.push_back(std::binary_search(owned.begin(), owned.end(), r, by_id));
+    }
+    // a flock has at least two boids: eaten ones are ignored by all rules
+    while (boids.size() < 2) {
+      Boid pad{{0., 0.}, {1., 0.}};
+      pad.is_eaten() = true;
+      boids.push_back(pad);
+      ids.push_back(INT_MAX);
+      mine.push_back(false);
+    }
+    Flock flock{boids};
+    flock.advance(pars, d_t);
+    auto& state{flock.state()};
+    int const n{flock.size()};
+    preds.clear();
+    for (int i{0}; i != n; ++i) {
+      if (mine[i] && state[i].is_pred()) {
+        preds.push_back(record(state[i], ids[i]));
+      }
+    }
+    send(fd, preds);
+    receive(fd, all_preds);
+    // other workers' predators are given their actual new states, and their
+    // preys are left to them
+    for (int i{0}; i != n; ++i) {
+      if (mine[i]) {
+        continue;
+      }
+      if (state[i].is_pred()) {
+        state[i] = boid(*std::lower_bound(all_preds.begin(), all_preds.end(),
+                                          Record{ids[i], {}, {}, {}, {}, {}, {}},
+                                          by_id));
+      } else {
+        state[i].is_eaten() = true;
+      }
+    }
+    flock.capture(pars);
+    credits.clear();
+    for (int k{0}; k != static_cast<int>(flock.captures().size()); ++k) {
+      if (flock.captures()[k] > 0) {
+        credits.push_back({ids[flock.pred_indices()[k]], flock.captures()[k]});
+      }
+    }
+    kept.clear();
+    moved.clear();
+    for (Record const& r : owned) {
+      if (r.is_eaten) {
+        kept.push_back(r);
+      }
+    }
+    for (int i{0}; i != n; ++i) {
+      if (mine[i]) {
+        Record const r{record(state[i], ids[i])};
+        (strips.of(r.x) == w ? kept : moved).push_back(r);
+      }
+    }
+    send(fd, moved);
+    send(fd, credits);
+    receive(fd, moved);
+    kept.insert(kept.end(), moved.begin(), moved.end());
+    std::sort(kept.begin(), kept.end(), by_id);
+    owned.swap(kept);
+  }
+  send(fd, owned);
+}
+
+// forked workers and the calling process' ends of their sockets. Closing them
+// makes the workers fail at their next message, so that they are always reaped
+class Workers
+{
+  std::vector<int> fds_;
+  std::vector<pid_t> pids_;
+
+ public:
+  explicit Workers(Parameters const& pars, Strips const& strips, int n)
+  {
+    for (int w{0}; w != n; ++w) {
+      int pair[2];
+      if (::socketpair(AF_UNIX, SOCK_STREAM, 0, pair) != 0) {
+        throw std::runtime_error{"decomposed simulation: no socket"};
+      }
+      pid_t const pid{::fork()};
+      if (pid == 0) {
+        for (int fd : fds_) {
+          ::close(fd);
+        }
+        ::close(pair[0]);
+        int status{0};
+        try {
+          work(pair[1], w, pars, strips);
+        } catch (...) {
+          status = 1;
+        }
+        ::_exit(status);
+      }
+      ::close(pair[1]);
+      if (pid < 0) {
+        ::close(pair[0]);
+        throw std::runtime_error{"decomposed simulation: no process"};
+      }
+      fds_.push_back(pair[0]);
+      pids_.push_back(pid);
+    }
+  }
+  Workers(Workers const&)            = delete;
+  Workers& operator=(Workers const&) = delete;
+  ~Workers()
+  {
+    close();
+  }
+  int fd(int w) const
+  {
+    return fds_[w];
+  }
+  // returns true if every worker exited normally
+  bool close()
+  {
+    for (int fd : fds_) {
+      ::close(fd);
+    }
+    fds_.clear();
+    bool ok{true};
+    for (pid_t pid : pids_) {
+      int status{0};
+      while (::waitpid(pid, &status, 0) < 0 && errno == EINTR) {
+      }
+      ok = ok && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+    }
+    pids_.clear();
+    return ok;
+  }
+};
+} // namespace
+
+int simulate_decomposed(Flock& flock, Parameters const& pars, int workers)
+{
+  is_greater_than(workers, 0, "workers");
+  if (pars.get_adaptive_steps() || pars.get_periodic() || pars.get_far_field()
+      || pars.get_reorder_interval() > 0) {
+    throw Invalid_Parameter{
+        "Decomposed simulations support neither adaptive steps, periodic "
+        "worlds, far-field sums nor reordering"};
+  }
+  // captures in a strip involve predators within the halo at the step's start
+  double const d_t{pars.get_duration() / pars.get_steps()};
+  if (pars.get_d_s_pred() / 24.5 + 2. * pars.get_max_speed() * d_t
+      >= ghost_reach(pars)) {
+    throw Invalid_Parameter{"Decomposed simulations need steps shorter than "
+                            "the halo of the strips"};
+  }
+  auto const& pred_indices{flock.pred_indices()};
+  if (!std::is_sorted(pred_indices.begin(), pred_indices.end())) {
+    throw Invalid_Parameter{
+        "Decomposed simulations need predators in flock order"};
+  }
+  Strips const strips{pars, workers};
+  double const reach{halo(pars)};
+  Workers team{pars, strips, workers};
+  std::vector<std::vector<Record>> out(workers);
+  std::vector<std::vector<Record>> bands(workers);
+  std::vector<Record> all_preds;
+  std::vector<Record> message;
+  std::vector<int> owner(flock.size());
+  std::vector<Candidate> best;
+  std::vector<Candidate> candidates;
+  std::vector<Credit> credits;
+  std::vector<int> captured(flock.size(), 0);
+  for (int i{0}; i != flock.size(); ++i) {
+    Record const r{record(flock.state()[i], i)};
+    out[strips.of(r.x)].push_back(r);
+  }
+  for (int w{0}; w != workers; ++w) {
+    send(team.fd(w), out[w]);
+  }
+  for (int step{0}; step != pars.get_steps(); ++step) {
+    // 1. halo
+    all_preds.clear();
+    for (int w{0}; w != workers; ++w) {
+      receive(team.fd(w), bands[w]);
+      for (Record const& r : receive(team.fd(w), message)) {
+        owner[r.id] = w;
+        all_preds.push_back(r);
+      }
+    }
+    std::sort(all_preds.begin(), all_preds.end(), by_id);
+    for (int w{0}; w != workers; ++w) {
+      message.clear();
+      for (int u{0}; u != workers; ++u) {
+        if (u == w) {
+          continue;
+        }
+        for (Record const& r : bands[u]) {
+          if (r.x > strips.lo(w) - reach && r.x < strips.hi(w) + reach) {
+            message.push_back(r);
+          }
+        }
+      }
+      send(team.fd(w), message);
+      send(team.fd(w), all_preds);
+    }
+    // 2. preys: candidates come in the order of all_preds
+    if (pars.get_seek_type() == 0) {
+      double const none{std::numeric_limits<double>::infinity()};
+      best.assign(all_preds.size(), {0, none, {}});
+      for (int w{0}; w != workers; ++w) {
+        receive(team.fd(w), candidates);
+        for (int k{0}; k != static_cast<int>(candidates.size()); ++k) {
+          Candidate const& c{candidates[k]};
+          if (c.d2 < best[k].d2
+              || (c.d2 == best[k].d2 && c.d2 != none
+                  && c.prey.id < best[k].prey.id)) {
+            best[k] = c;
+          }
+        }
+      }
+      for (int w{0}; w != workers; ++w) {
+        candidates.clear();
+        for (int k{0}; k != static_cast<int>(all_preds.size()); ++k) {
+          if (owner[all_preds[k].id] == w) {
+            candidates.push_back(best[k]);
+          }
+        }
+        send(team.fd(w), candidates);
+      }
+    }
+    // 3. predators' new states
+    all_preds.clear();
+    for (int w{0}; w != workers; ++w) {
+      auto const& preds{receive(team.fd(w), message)};
+      all_preds.insert(all_preds.end(), preds.begin(), preds.end());
+    }
+    std::sort(all_preds.begin(), all_preds.end(), by_id);
+    for (int w{0}; w != workers; ++w) {
+      send(team.fd(w), all_preds);
+    }
+    // 4. migration and captures
+    for (auto& boids : out) {
+      boids.clear();
+    }
+    for (int w{0}; w != workers; ++w) {
+      for (Record const& r : receive(team.fd(w), message)) {
+        out[strips.of(r.x)].push_back(r);
+      }
+      for (Credit const& c : receive(team.fd(w), credits)) {
+        captured[c.pred] += c.preys;
+      }
+    }
+    for (int w{0}; w != workers; ++w) {
+      send(team.fd(w), out[w]);
+    }
+  }
+  auto& state{flock.state()};
+  for (int w{0}; w != workers; ++w) {
+    for (Record const& r : receive(team.fd(w), message)) {
+      state[r.id] = boid(r);
+    }
+  }
+  if (!team.close()) {
+    throw std::runtime_error{"decomposed simulation: a worker failed"};
+  }
+  for (int k{0}; k != static_cast<int>(pred_indices.size()); ++k) {
+    flock.captures()[k] += captured[pred_indices[k]];
+    flock.counter() += captured[pred_indices[k]];
+  }
+  return pars.get_steps();
+}
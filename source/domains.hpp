@@ -0,0 +1,25 @@
+#ifndef DOMAINS_HPP
+#define DOMAINS_HPP
+
+#include "flock.hpp"
+
+// defines simulate_decomposed, simulating a flock with worker processes that
+// each own the boids in a vertical strip of the box
+
+// the box is split into [workers] strips of equal width (the border ones also
+// own the boids out of the box), each owned by a worker process forked for the
+// simulation and talking to the calling one through a Unix socket. At every
+// step a worker gets from the others their boids within the halo of its strip
+// (the longest distance of the rules, see ghost_reach) and every predator, then
+// computes the new states of its boids with Flock::advance and Flock::capture,
+// and hands the boids that left its strip over to their new owner. Predators
+// seeking the nearest prey get it from the worker owning it, wherever it is.
+// Boids are kept in flock order, so that states, counter and captures are the
+// ones simulate would give the flock, bit for bit. Returns the number of steps
+// performed. Throws Invalid_Parameter for settings needing the whole flock at
+// every step (adaptive steps, periodic world, far-field sums, reordering) or
+// a halo a boid could cross within a step, and std::runtime_error if a worker
+// fails. States before the last step and the capture log are not kept
+int simulate_decomposed(Flock& flock, Parameters const& pars, int workers);
+
+#endif
@@ -0,0 +1,90 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "domains.hpp"
+#include "doctest.h"
+
+namespace {
+// whether two flocks are in the same state, bit for bit
+void check_same(Flock const& flock, Flock const& other)
+{
+  REQUIRE(flock.size() == other.size());
+  for (int i{0}; i != flock.size(); ++i) {
+    CHECK(flock.state()[i].position() == other.state()[i].position());
+    CHECK(flock.state()[i].velocity() == other.state()[i].velocity());
+    CHECK(flock.state()[i].is_eaten() == other.state()[i].is_eaten());
+  }
+  CHECK(flock.counter() == other.counter());
+  CHECK(flock.captures() == other.captures());
+}
+} // namespace
+
+TEST_CASE("Testing decomposed simulations")
+{
+  int captured{0};
+  for (int seek_type : {0, 1, 2}) {
+    Parameters pars{300., 35., 3.5, .7,  .045, .8, 80., .05,
+                    30.,  300, 40,  300, 200,  4,  seek_type};
+    std::vector<Boid> boids{};
+    Flock flock{fill(boids, pars, 2468u)};
+    add_predators(flock, pars, 2468u);
+    Flock whole{flock};
+    CHECK(simulate(whole, pars) == pars.get_steps());
+    captured += whole.counter();
+
+    SUBCASE("any number of strips gives the same flock")
+    {
+      for (int workers : {1, 2, 3, 5}) {
+        Flock split{flock};
+        CHECK(simulate_decomposed(split, pars, workers) == pars.get_steps());
+        check_same(split, whole);
+      }
+    }
+
+    SUBCASE("with swept capture and the grid engine")
+    {
+      pars.set_swept_capture() = true;
+      pars.set_engine()        = Engine::grid;
+      Flock swept{flock};
+      simulate(swept, pars);
+      Flock split{flock};
+      simulate_decomposed(split, pars, 3);
+      check_same(split, swept);
+    }
+  }
+  // predators do catch preys across strips
+  CHECK(captured > 0);
+}
+
+TEST_CASE("Testing decomposed simulations' settings")
+{
+  Parameters pars{300., 35., 3.5, .7,  .045, .8, 80., .05,
+                  30.,  300, 40,  300, 60,   2,  0};
+  std::vector<Boid> boids{};
+  Flock flock{fill(boids, pars, 1357u)};
+  add_predators(flock, pars, 1357u);
+
+  CHECK_THROWS_AS(simulate_decomposed(flock, pars, 0), Invalid_Parameter);
+  SUBCASE("adaptive steps")
+  {
+    pars.set_adaptive_steps() = true;
+  }
+  SUBCASE("periodic world")
+  {
+    pars.set_periodic() = true;
+  }
+  SUBCASE("far field")
+  {
+    pars.set_far_field() = true;
+  }
+  SUBCASE("reordering")
+  {
+    pars.set_reorder_interval() = 10;
+  }
+  SUBCASE("steps crossing the halo")
+  {
+    pars = Parameters{300., 35., 3.5, .7, .045, .8, 80., .05,
+                      30.,  30,  10,  30, 60,   2,  0};
+  }
+  CHECK_THROWS_AS(simulate_decomposed(flock, pars, 2), Invalid_Parameter);
+  // the flock is left untouched
+  CHECK(flock.counter() == 0);
+}
@@ -1,100 +1,316 @@
 #include "flock.hpp"
+#include "parallel.hpp"
+#include "random.hpp"
 #include <algorithm>
+#include <array>
+#include <chrono>
 #include <functional>
+#include <limits>
 #include <numeric>
-#include <random>
 
 // defining flocks' flying rules (different for regular boid and predator)
 // functions to perform simulation (methods solve and evolve, fill, simulate)
 
 // all flying rules don't take into account eaten boids
 
-// fills vector with neighbours of boid (inserting also boid itself, if boid is
-// regular)
-std::vector<Boid>& neighbours(Boid const& boid, Flock const& flock,
-                              std::vector<Boid>& nbrs, double angle, double d)
+// query functions fill a vector with the indices in flock.images() of the
+// boids they select, in increasing order. Indices are stable (boids are never
+// erased from a flock, eaten ones are only flagged), so they identify boids
+// without copying them. They are defined once for any vector of ints: plain
+// vectors (handy in tests) or vectors drawing memory from an Arena
+namespace {
+template<class Indices, class Selected>
+Indices& select(Flock const& flock, Indices& indices, Selected selected)
 {
-  assert(nbrs.empty());     // expects an empty vector to copy neighbours in
+  assert(indices.empty());  // expects an empty vector to fill indices in
   assert(flock.size() > 1); // expects a flock with more than one boid
-  std::copy_if((flock.state().begin()), (flock.state().end()),
-               std::back_inserter(nbrs), [=, &boid](Boid const& other) {
-                 return (!(other.is_pred())) && ((!other.is_eaten()))
-                     && (is_seen(boid, other, angle))
-                     && (distance(boid, other) < d);
-               });
+  auto const& boids{flock.images()};
+  for (int i{0}; i != static_cast<int>(boids.size()); ++i) {
+    if (selected(boids[i])) {
+      indices.push_back(i);
+    }
+  }
+  return indices;
+}
+
+// keep functor of the spatial queries: a region is searched only if it may be
+// in viewer's field of view, unless culling is disabled
+auto in_view(Flock const& flock, Boid const& viewer, double angle)
+{
+  return [cone = View_cone{viewer, angle}, cull = flock.view_culling()](
+             double x0, double y0, double x1, double y1) {
+    return !cull || cone.may_see(x0, y0, x1, y1);
+  };
+}
+
+template<class Indices>
+Indices& select_neighbours(Boid const& boid, Flock const& flock, Indices& nbrs,
+                           double angle, double d)
+{
   // a regular boid is a neighbour if close enough and in the field of view
+  auto const selected{[=, &boid](Boid const& other) {
+    return (!(other.is_pred())) && ((!other.is_eaten()))
+        && (is_seen(boid, other, angle)) && (distance(boid, other) < d);
+  }};
+  if (flock.tree().built()) {
+    assert(nbrs.empty());
+    return flock.tree().select(boid, angle, d, nbrs, flock.view_culling());
+  }
+  // candidates of the tiled engine are already in increasing order, and carry
+  // distance() and is_seen() as computed for them. They only cover boids of the
+  // flock (not copies), distances up to their radius and their angle of view
+  Tiles const& tiles{flock.tiles()};
+  if (tiles.built() && d <= tiles.radius() && angle == tiles.angle()) {
+    int const i{flock.index_of(boid)};
+    if (i != -1) {
+      assert(nbrs.empty());
+      auto const& boids{flock.images()};
+      tiles.for_each_near(i, [&](Tiles::Candidate const& candidate) {
+        if (candidate.seen && candidate.distance < d
+            && !boids[candidate.index].is_eaten()) {
+          nbrs.push_back(candidate.index);
+        }
+      });
+      return nbrs;
+    }
+  }
+  if (!flock.grid().built()) {
+    return select(flock, nbrs, selected);
+  }
+  // the grid only narrows down the candidates: they are checked as above and
+  // sorted, so that the selection (and the order of sums over it) is the same
+  assert(nbrs.empty());
+  auto const& boids{flock.images()};
+  flock.grid().for_each_near(
+      boid.position(), d,
+      [&](int i) {
+        if (selected(boids[i])) {
+          nbrs.push_back(i);
+        }
+      },
+      in_view(flock, boid, angle));
+  std::sort(nbrs.begin(), nbrs.end());
   return nbrs;
 }
-// NB: function neighbour can be used to obtain close-neighbours as well, simply
-// by passing d_s instead of d as the last argument!
 
-// fills vector with predators of boid (NOT inserting boid itself)
-std::vector<Boid>& predators(Boid const& boid, Flock const& flock,
-                             std::vector<Boid>& preds, double angle,
-                             double d_s_pred)
+// predators are looked for among the registered ones only. Distances are
+// computed a block at a time from the contiguous coordinates (a loop the
+// compiler can vectorize) with the same formula as distance(), so the
+// selection is unchanged; angles are checked only for predators within d. In a
+// periodic world the ghost predators are checked last, one at a time (their
+// indices follow the ones of the boids)
+template<class Indices>
+Indices& select_registered(Boid const& boid, Flock const& flock,
+                           Indices& preds, double angle, double d)
+{
+  assert(preds.empty());    // expects an empty vector to fill indices in
+  assert(flock.size() > 1); // expects a flock with more than one boid
+  constexpr int block{8};
+  int const n_preds{static_cast<int>(flock.pred_indices().size())};
+  double const* const x{flock.preds_x().data()};
+  double const* const y{flock.preds_y().data()};
+  double const b_x{boid.position().x()};
+  double const b_y{boid.position().y()};
+  std::array<double, block> squared;
+  for (int first{0}; first < n_preds; first += block) {
+    int const last{std::min(first + block, n_preds)};
+    for (int k{first}; k < last; ++k) {
+      double const xdiff{b_x - x[k]};
+      double const ydiff{b_y - y[k]};
+      squared[k - first] = xdiff * xdiff + ydiff * ydiff;
+    }
+    for (int k{first}; k < last; ++k) {
+      int const i{flock.pred_indices()[k]};
+      if (std::sqrt(squared[k - first]) < d
+          && is_seen(boid, flock.state()[i], angle)) {
+        preds.push_back(i);
+      }
+    }
+  }
+  for (int i : flock.ghost_preds()) {
+    Boid const& pred{flock.images()[i]};
+    if (distance(boid, pred) < d && is_seen(boid, pred, angle)) {
+      preds.push_back(i);
+    }
+  }
+  return preds;
+}
+
+template<class Indices>
+Indices& select_predators(Boid const& boid, Flock const& flock, Indices& preds,
+                          double angle, double d_s_pred)
 {
   assert(!(boid.is_pred())); // only regular boids feel STRONG separation from
                              // predators
-  assert(preds.empty());     // expects an empty vector to copy predators in
-  assert(flock.size() > 1);  // expects a flock with more than one boid
-  std::copy_if((flock.state().begin()), (flock.state().end()),
-               std::back_inserter(preds), [=, &boid](Boid const& other) {
-                 return ((other.is_pred()) && (is_seen(boid, other, angle))
-                         && (distance(boid, other)
-                             < d_s_pred)); // separation distance is greater
-                                           // towards predators
-               });
-  return preds;
+  // separation distance is greater towards predators
+  return select_registered(boid, flock, preds, angle, d_s_pred);
 }
 
-// fills vector with close predators in sight (inserting boid itself)
-std::vector<Boid>& competitors(Boid const& boid, Flock const& flock,
-                               std::vector<Boid>& comps, double angle,
-                               double d_s)
+template<class Indices>
+Indices& select_competitors(Boid const& boid, Flock const& flock,
+                            Indices& comps, double angle, double d_s)
 {
   assert(boid.is_pred());
-  assert(comps.empty());    // expects an empty vector to copy competitors in
-  assert(flock.size() > 1); // expects a flock with more than one boid
-  std::copy_if((flock.state().begin()), (flock.state().end()),
-               std::back_inserter(comps), [=, &boid](Boid const& other) {
-                 return ((other.is_pred()) && (is_seen(boid, other, angle))
-                         && (distance(boid, other) < d_s));
-               });
   // predators are peers: they separate with regular separation factor
-  return comps;
+  return select_registered(boid, flock, comps, angle, d_s);
 }
+} // namespace
 
-// returns predator boid's prey, i.e the nearest regular boid in sight
+// fills vector with neighbours of boid (inserting also boid itself, if boid is
+// regular)
+std::vector<int>& neighbours(Boid const& boid, Flock const& flock,
+                             std::vector<int>& nbrs, double angle, double d)
+{
+  return select_neighbours(boid, flock, nbrs, angle, d);
+}
+std::pmr::vector<int>& neighbours(Boid const& boid, Flock const& flock,
+                                  std::pmr::vector<int>& nbrs, double angle,
+                                  double d)
+{
+  return select_neighbours(boid, flock, nbrs, angle, d);
+}
+// NB: function neighbour can be used to obtain close-neighbours as well, simply
+// by passing d_s instead of d as the last argument!
+
+// fills vector with predators of boid (NOT inserting boid itself)
+std::vector<int>& predators(Boid const& boid, Flock const& flock,
+                            std::vector<int>& preds, double angle,
+                            double d_s_pred)
+{
+  return select_predators(boid, flock, preds, angle, d_s_pred);
+}
+std::pmr::vector<int>& predators(Boid const& boid, Flock const& flock,
+                                 std::pmr::vector<int>& preds, double angle,
+                                 double d_s_pred)
+{
+  return select_predators(boid, flock, preds, angle, d_s_pred);
+}
+
+// fills vector with close predators in sight (inserting boid itself)
+std::vector<int>& competitors(Boid const& boid, Flock const& flock,
+                              std::vector<int>& comps, double angle, double d_s)
+{
+  return select_competitors(boid, flock, comps, angle, d_s);
+}
+std::pmr::vector<int>& competitors(Boid const& boid, Flock const& flock,
+                                   std::pmr::vector<int>& comps, double angle,
+                                   double d_s)
+{
+  return select_competitors(boid, flock, comps, angle, d_s);
+}
+
+// cells surely out of range or out of view are skipped, and cells surely within
+// both are taken whole; only the others are checked a boid at a time, as by
+// neighbours. With tolerance 0 the sums are the exact ones (up to the order of
+// the additions); a positive tolerance takes whole the cells within
+// (1 + tolerance) d and skips the ones beyond (1 - tolerance) d, trading exact
+// checks for miscounting boids in that band
+Grid::Sums far_field(Boid const& boid, Flock const& flock, double angle,
+                     double d, double tolerance)
+{
+  assert(flock.grid().aggregated());
+  assert(tolerance >= 0. && tolerance < 1.);
+  auto const& boids{flock.images()};
+  View_cone const cone{boid, angle};
+  double const p_x{boid.position().x()};
+  double const p_y{boid.position().y()};
+  auto const cover{[&](double x0, double y0, double x1, double y1) {
+    double const near_x{std::max({x0 - p_x, 0., p_x - x1})};
+    double const near_y{std::max({y0 - p_y, 0., p_y - y1})};
+    if (std::sqrt(near_x * near_x + near_y * near_y) >= (1. - tolerance) * d
+        || !cone.may_see(x0, y0, x1, y1)) {
+      return Grid::Cover::none;
+    }
+    double const far_x{std::max(p_x - x0, x1 - p_x)};
+    double const far_y{std::max(p_y - y0, y1 - p_y)};
+    // widened, to absorb the rounding of distance()
+    if (std::sqrt(far_x * far_x + far_y * far_y) * (1. + 1e-9)
+            < (1. + tolerance) * d
+        && cone.sees_all(x0, y0, x1, y1)) {
+      return Grid::Cover::whole;
+    }
+    return Grid::Cover::part;
+  }};
+  Grid::Sums total{};
+  flock.grid().for_each_cover(
+      boid.position(), (1. + tolerance) * d, cover,
+      [&](Grid::Sums const& sums) {
+        total.position += sums.position;
+        total.velocity += sums.velocity;
+        total.count += sums.count;
+      },
+      [&](int i) {
+        Boid const& other{boids[i]};
+        if (is_seen(boid, other, angle) && distance(boid, other) < d) {
+          total.position += other.position();
+          total.velocity += other.velocity();
+          ++total.count;
+        }
+      });
+  return total;
+}
+
+// returns predator boid's prey, i.e the nearest alive regular boid in sight
+// (the first in flock order among equally near ones), or boid itself if no prey
+// is in sight. The indices of the grid and quadtree engines are searched
+// outwards from boid; otherwise boids are scanned once. Distances are compared
+// squared, and visibility is only checked for boids nearer than the best prey
+// found so far. In a periodic world, ghost images only extend to the reach of
+// the rules: if no prey is in sight within it, the boids are scanned again by
+// their nearest image, and the prey found is returned as it is in state()
 Boid const& find_prey(Boid const& boid, Flock const& flock, double angle)
 {
   assert(boid.is_pred());   // only predators feel the seek drive towards preys
   assert(flock.size() > 1); // expects a flock with more than one boid
-
-  // checking if at least one alive regular boid is in sight
-  auto it{std::find_if((flock.state().begin()), (flock.state().end()),
-                       [=, &boid](Boid const& b) {
-                         return ((!(b.is_pred())) && (!(b.is_eaten()))
-                                 && (is_seen(boid, b, angle)));
-                       })};
-  // If none is, boid itself is returned
-  if (it == (flock.state().end())) {
-    return boid;
+  auto const& boids{flock.images()};
+  auto const visible{[&](int i) {
+    Boid const& b{boids[i]};
+    return !b.is_pred() && !b.is_eaten() && is_seen(boid, b, angle);
+  }};
+  int prey{-1};
+  if (flock.tree().built()) {
+    prey = flock.tree().nearest(boid.position(), visible,
+                                in_view(flock, boid, angle));
+  } else if (flock.grid().built()) {
+    prey = flock.grid().nearest(boids, boid.position(), visible,
+                                in_view(flock, boid, angle));
   } else {
-    // with std::min_element an element is the smallest if no other element
-    // compares less than it
-    auto prey{std::min_element(
-        (flock.state().begin()), (flock.state().end()),
-        [=, &boid](Boid const& b1, Boid const& b2) {
-          return (b2.is_pred())
-                   ? (!(b1.is_pred()) && (is_seen(boid, b1, angle))
-                      && (!(b1.is_eaten())))
-                   : (!(b1.is_pred()) && (is_seen(boid, b1, angle))
-                      && (!(b1.is_eaten()))
-                      && (distance(boid, b1) < distance(boid, b2)));
-        })};
-    assert(!(prey->is_pred()));
-    return *prey;
+    double prey_d2{std::numeric_limits<double>::infinity()};
+    for (int i{0}; i != static_cast<int>(boids.size()); ++i) {
+      double const d2{squared_distance(boid.position(), boids[i].position())};
+      if (d2 < prey_d2 && visible(i)) {
+        prey    = i;
+        prey_d2 = d2;
+      }
+    }
   }
+  double const reach{flock.reach()};
+  if (flock.periodic()
+      && (prey == -1
+          || squared_distance(boid.position(), boids[prey].position())
+                 >= reach * reach)) {
+    auto const& box{flock.box()};
+    prey = -1;
+    double prey_d2{std::numeric_limits<double>::infinity()};
+    for (int i{0}; i != flock.size(); ++i) {
+      Boid const& b{boids[i]};
+      if (b.is_pred() || b.is_eaten()) {
+        continue;
+      }
+      Boid const image{
+          nearest_image(b, boid.position(), box[0], box[1], box[2], box[3])};
+      double const d2{squared_distance(boid.position(), image.position())};
+      if (d2 < prey_d2 && is_seen(boid, image, angle)) {
+        prey    = i;
+        prey_d2 = d2;
+      }
+    }
+  }
+  if (prey == -1) {
+    return boid;
+  }
+  assert(!(boids[prey].is_pred()));
+  return boids[prey];
 }
 
 double ang_dist(Boid const& pred, Boid const& b1, Boid const& b2)
@@ -106,70 +322,161 @@ double ang_dist(Boid const& pred, Boid const& b1, Boid const& b2)
   return std::abs(ang2 - ang1);
 }
 
-double min_ang_dist(Boid const& pred, Boid const& boid,
-                    std::vector<Boid> const& nbrs, double angle)
+// angular distance (as seen from pred) between the i-th of nbrs and the
+// closest of the others; infinite if it has no other neighbours. Boids are told
+// apart by their index, so coinciding preys are not mistaken for the same one
+double min_ang_dist(Boid const& pred, Flock const& flock,
+                    std::pmr::vector<int> const& nbrs, int i)
 {
   assert(pred.is_pred());
-  std::vector<Boid> flock1;
-  // remove the boid we are considering
-  std::copy_if(nbrs.begin(), nbrs.end(), std::back_inserter(flock1),
-               [&, angle](Boid const& other) {
-                 return !(boid.position() == other.position());
-               });
-
-  std::vector<double> dists;
-  std::transform(
-      flock1.begin(), flock1.end(), std::back_inserter(dists),
-      [&](Boid const& other) { return ang_dist(pred, boid, other); });
-
-  return *std::min_element(dists.begin(), dists.end());
+  auto const& boids{flock.images()};
+  double min_dist{std::numeric_limits<double>::infinity()};
+  for (int j{0}; j != static_cast<int>(nbrs.size()); ++j) {
+    if (j != i) {
+      min_dist = std::min(min_dist,
+                          ang_dist(pred, boids[nbrs[i]], boids[nbrs[j]]));
+    }
+  }
+  return min_dist;
 }
 
-Boid find_prey_isolated(Boid const& boid, Flock const& flock, double angle,
-                        double dist)
+Boid const& find_prey_isolated(Boid const& boid, Flock const& flock,
+                               double angle, double dist, Arena& arena)
 {
   assert(boid.is_pred());   // only predators feel the seek drive towards preys
   assert(flock.size() > 1); // expects a flock with more than one boid
 
-  // checking if at least one alive regular boid is in sight and in distance
-  auto it{std::find_if((flock.state().begin()), (flock.state().end()),
-                       [=, &boid](Boid const& b) {
-                         return ((!(b.is_pred())) && (is_seen(boid, b, angle))
-                                 && (!(b.is_eaten()))
-                                 && distance(boid, b) < dist);
-                       })};
-  // If none is, boid itself is returned
-  if (it == (flock.state().end())) {
+  std::pmr::vector<int> nbrs{arena.resource()};
+  neighbours(boid, flock, nbrs, angle, dist);
+  // If no alive regular boid is in sight and in distance, boid itself is
+  // returned
+  if (nbrs.empty()) {
     return boid;
-  } else {
-    std::vector<Boid> nbrs;
-    neighbours(boid, flock, nbrs, angle, dist);
-    // not risking narrowing since N_nbrs < N_boids which is an int
-    int vec_size{static_cast<int>(nbrs.size())};
-    assert(vec_size >= 1);
-    auto most_isolated_it{std::max_element(
-        nbrs.begin(), nbrs.end(), [&, angle](Boid const& b1, Boid const& b2) {
-          return min_ang_dist(boid, b1, nbrs, angle)
-               < min_ang_dist(boid, b2, nbrs, angle);
-        })};
-    assert(most_isolated_it != nbrs.end());
-    Boid prey{*most_isolated_it};
-    assert(!(prey.is_pred()));
-    return prey;
   }
+  // isolation of each neighbour is computed once, instead of twice per
+  // comparison within std::max_element
+  std::pmr::vector<double> isolation(nbrs.size(), 0., arena.resource());
+  for (int i{0}; i != static_cast<int>(nbrs.size()); ++i) {
+    isolation[i] = min_ang_dist(boid, flock, nbrs, i);
+  }
+  // with std::max_element the first of equally isolated boids is picked
+  Boid const& prey{flock.images()[nbrs[std::max_element(isolation.begin(),
+                                                       isolation.end())
+                                      - isolation.begin()]]};
+  assert(!(prey.is_pred()));
+  return prey;
+}
+
+Boid const& find_prey_isolated(Boid const& boid, Flock const& flock,
+                               double angle, double dist)
+{
+  Arena& arena{thread_arena()};
+  Arena::Scope scope{arena};
+  return find_prey_isolated(boid, flock, angle, dist, arena);
 }
 
-// tells if second boid is victim of the first one
+// tells if second boid is victim of the first one. In a periodic world the
+// regular boid is taken at its image nearest to the predator
 bool is_victim(Boid const& predator, Boid const& regular,
                Parameters const& pars)
 {
   assert(predator.is_pred());
+  if (pars.get_periodic()) {
+    Boid const image{nearest_image(regular, predator.position(),
+                                   pars.get_x_min(), pars.get_x_max(),
+                                   pars.get_y_min(), pars.get_y_max())};
+    return !regular.is_pred() && !regular.is_eaten()
+        && is_seen(predator, image, pars.get_pred_angle())
+        && distance(predator, image) < pars.get_d_s_pred() / 24.5;
+  }
   return ((!(regular.is_pred())) && (!(regular.is_eaten()))
-          && (is_seen(predator, regular, pars.get_angle()))
+          && (is_seen(predator, regular, pars.get_pred_angle()))
           && (distance(predator, regular) < (pars.get_d_s_pred() / 24.5)));
 }
 
-// changes boids' parameter is_eaten and increases flock's internal counter
+namespace {
+// position of the prey relative to the predator before a step, and its change
+// over the step. In a periodic world the prey is taken at its image nearest to
+// the predator, before and after the step
+std::pair<Position, Position> relative_motion(Boid const& pred_before,
+                                              Boid const& predator,
+                                              Boid const& regular_before,
+                                              Boid const& regular,
+                                              Parameters const& pars)
+{
+  auto const image{[&](Boid const& b, Boid const& pred) {
+    return pars.get_periodic()
+             ? nearest_image(b, pred.position(), pars.get_x_min(),
+                             pars.get_x_max(), pars.get_y_min(),
+                             pars.get_y_max())
+                   .position()
+             : b.position();
+  }};
+  Position const r0{image(regular_before, pred_before)
+                    - pred_before.position()};
+  Position const dr{(image(regular, predator) - predator.position()) - r0};
+  return {r0, dr};
+}
+
+// predator and prey at fraction t of a step, both moving in a straight line
+// (see relative_motion). The predator looks where it was heading during the
+// step
+std::pair<Boid, Boid> states_at(double t, Boid const& pred_before,
+                                Boid const& predator, Boid const& regular,
+                                Position const& r0, Position const& dr)
+{
+  Position const p_pos{pred_before.position().x()
+                           + t * (predator.position().x()
+                                  - pred_before.position().x()),
+                       pred_before.position().y()
+                           + t * (predator.position().y()
+                                  - pred_before.position().y())};
+  return {Boid{p_pos, pred_before.velocity(), true},
+          Boid{Position{p_pos.x() + r0.x() + t * dr.x(),
+                        p_pos.y() + r0.y() + t * dr.y()},
+               regular.velocity()}};
+}
+} // namespace
+
+// swept version of is_victim, taking the states of both boids before and after
+// the step. Besides the preys is_victim catches, it catches the ones the
+// predator passed by during the step (which, with a large d_t, could tunnel
+// through the capture radius between two consecutive checks). Both boids move
+// in a straight line during a step, so their relative position moves on a
+// segment too: its minimum distance is at one end of the segment or at the
+// foot of the perpendicular from the origin. In a periodic world relative
+// positions are the ones of the nearest images, before and after the step.
+// Returns the time of the capture as a fraction of the step: 1 for the preys
+// is_victim catches, else the time of closest approach
+std::optional<double> is_victim(Boid const& pred_before, Boid const& predator,
+                                Boid const& regular_before,
+                                Boid const& regular, Parameters const& pars)
+{
+  assert(predator.is_pred() && pred_before.is_pred());
+  if (is_victim(predator, regular, pars)) {
+    return 1.;
+  }
+  if (regular.is_pred() || regular.is_eaten()) {
+    return std::nullopt;
+  }
+  auto const [r0, dr]{relative_motion(pred_before, predator, regular_before,
+                                      regular, pars)};
+  double const dr2{dr.x() * dr.x() + dr.y() * dr.y()};
+  double const t{(dr2 > 0.)
+                     ? std::clamp(-(r0.x() * dr.x() + r0.y() * dr.y()) / dr2,
+                                  0., 1.)
+                     : 0.};
+  auto const [pred, prey]{states_at(t, pred_before, predator, regular, r0, dr)};
+  if (is_seen(pred, prey, pars.get_pred_angle())
+      && distance(pred, prey) < (pars.get_d_s_pred() / 24.5)) {
+    return t;
+  }
+  return std::nullopt;
+}
+
+// changes boids' parameter is_eaten and increases flock's internal counter.
+// Serial reference of Flock::capture: a prey within reach of more than one
+// predator is eaten by the first of them in flock order
 void set_victims(Boid const& boid, Flock& flock, Parameters const& pars)
 {
   // only preds can eat boids
@@ -187,43 +494,58 @@ void set_victims(Boid const& boid, Flock& flock, Parameters const& pars)
 // does not influence sum, since (boid.position()-boid.position()) equals
 // {0.,0.}
 Velocity separation(Boid const& boid, Flock const& flock,
-                    Parameters const& pars)
+                    Parameters const& pars, Arena& arena)
 {
+  auto const& boids{flock.images()};
   // if boid is a predator, he feels (normal) separation from other preds only
   if (boid.is_pred()) {
-    std::vector<Boid> comps{};
-    competitors(boid, flock, comps, pars.get_angle(), pars.get_d_s());
+    std::pmr::vector<int> comps{arena.resource()};
+    competitors(boid, flock, comps, pars.get_pred_angle(),
+                pars.get_pred_d_s());
     auto sum{std::transform_reduce(
         (comps.begin()), (comps.end()), Position{0., 0.}, std::plus<>{},
-        [&](Boid const& other) {
-          return (other.position() - boid.position()) * (-pars.get_s());
+        [&](int other) {
+          return (boids[other].position() - boid.position())
+               * (-pars.get_pred_s());
         })};
     // reduce can be used since vectorial sum is commutative and associative
     return {sum.x(), sum.y()};
   } else {
     // regular boids feel (normal) separation from close neighbours and strong
     // separation from close predators
-    std::vector<Boid> close_nbrs{};
+    std::pmr::vector<int> close_nbrs{arena.resource()};
     neighbours(boid, flock, close_nbrs, pars.get_angle(), pars.get_d_s());
     auto sum1{std::transform_reduce(
         (close_nbrs.begin()), (close_nbrs.end()), Position{0., 0.},
-        std::plus<>{}, [&](Boid const& other) {
-          return (other.position() - boid.position()) * (-pars.get_s());
+        std::plus<>{}, [&](int other) {
+          return (boids[other].position() - boid.position()) * (-pars.get_s());
         })};
-    std::vector<Boid> preds{};
+    std::pmr::vector<int> preds{arena.resource()};
     predators(boid, flock, preds, pars.get_angle(), pars.get_d_s_pred());
     auto sum2{std::transform_reduce(
         (preds.begin()), (preds.end()), Position{0., 0.}, std::plus<>{},
-        [&](Boid const& other) {
-          return (other.position() - boid.position()) * (-pars.get_s_pred());
+        [&](int other) {
+          return (boids[other].position() - boid.position())
+               * (-pars.get_s_pred());
         })};
     return {sum1.x() + sum2.x(), sum1.y() + sum2.y()};
   }
 }
 
-Velocity alignment(Boid const& boid, Flock const& flock, Parameters const& pars)
+Velocity alignment(Boid const& boid, Flock const& flock, Parameters const& pars,
+                   Arena& arena)
 {
-  std::vector<Boid> nbrs{};
+  if (pars.get_far_field() && flock.grid().aggregated()) {
+    Grid::Sums const sums{far_field(boid, flock, pars.get_angle(), pars.get_d(),
+                                    pars.get_far_field_tolerance())};
+    if (sums.count <= 1) {
+      return {0., 0.};
+    }
+    return (sums.velocity - boid.velocity() * sums.count)
+         * (pars.get_a() / (sums.count - 1));
+  }
+  auto const& boids{flock.images()};
+  std::pmr::vector<int> nbrs{arena.resource()};
   // note that neighbours will assert internally that boid is not a pred
   neighbours(boid, flock, nbrs, pars.get_angle(), pars.get_d());
   // not risking narrowing since N_nbrs < N_boids, which is an int
@@ -231,35 +553,51 @@ Velocity alignment(Boid const& boid, Flock const& flock, Parameters const& pars)
   if (vec_size == 1) { // if nbrs has only 1 element, it's boid itself
     return {0., 0.};
   } else {
-    return {std::transform_reduce((nbrs.begin()), (nbrs.end()),
-                                  Velocity{0., 0.}, std::plus<>{},
-                                  [&](Boid const& other) {
-                                    return (other.velocity() - boid.velocity())
-                                         * (pars.get_a() / (vec_size - 1));
-                                  })};
+    return {std::transform_reduce(
+        (nbrs.begin()), (nbrs.end()), Velocity{0., 0.}, std::plus<>{},
+        [&](int other) {
+          return (boids[other].velocity() - boid.velocity())
+               * (pars.get_a() / (vec_size - 1));
+        })};
   }
   // NB: the formula used here is equivalent to the one subtracting boid's
   // velocity to the mean of others' velocities, with the advantage of not
   // requiring erasing boid from nbrs
 }
 
-Velocity cohesion(Boid const& boid, Flock const& flock, Parameters const& pars)
+Velocity cohesion(Boid const& boid, Flock const& flock, Parameters const& pars,
+                  Arena& arena)
 {
-  std::vector<Boid> nbrs{};
+  // predators pursue the boids' center of mass by their own rules
   double distance{(boid.is_pred()) ? pars.get_d_s_pred() : pars.get_d()};
-  neighbours(boid, flock, nbrs, pars.get_angle(), distance);
+  double const angle{boid.is_pred() ? pars.get_pred_angle()
+                                    : pars.get_angle()};
+  double const c{boid.is_pred() ? pars.get_pred_c() : pars.get_c()};
+  if (pars.get_far_field() && flock.grid().aggregated()) {
+    Grid::Sums const sums{far_field(boid, flock, angle, distance,
+                                    pars.get_far_field_tolerance())};
+    if (sums.count <= 1) {
+      return {0., 0.};
+    }
+    Position const sum{(sums.position - boid.position() * sums.count)
+                       * (c / (sums.count - 1))};
+    return {sum.x(), sum.y()};
+  }
+  auto const& boids{flock.images()};
+  std::pmr::vector<int> nbrs{arena.resource()};
+  neighbours(boid, flock, nbrs, angle, distance);
   int vec_size{static_cast<int>(nbrs.size())}; // not risking narrowing since
   // N_nbrs < N_boids which is an int
   if (vec_size == 0 || vec_size == 1) {
     // for regular, if nbrs has only 1 element, it's boid itself
     return {0., 0.};
   } else {
-    auto sum{std::transform_reduce((nbrs.begin()), (nbrs.end()),
-                                   Position{0., 0.}, std::plus<>{},
-                                   [&](Boid const& other) {
-                                     return (other.position() - boid.position())
-                                          * (pars.get_c() / (vec_size - 1));
-                                   })};
+    auto sum{std::transform_reduce(
+        (nbrs.begin()), (nbrs.end()), Position{0., 0.}, std::plus<>{},
+        [&](int other) {
+          return (boids[other].position() - boid.position())
+               * (c / (vec_size - 1));
+        })};
     return {sum.x(), sum.y()};
   }
   // NB the formula used here is equivalent to the one subtracting boid's
@@ -267,36 +605,39 @@ Velocity cohesion(Boid const& boid, Flock const& flock, Parameters const& pars)
   // requiring erasing boid from nbrs
 }
 
-Velocity seek(Boid const& boid, Flock const& flock, Parameters const& pars)
+Velocity seek(Boid const& boid, Flock const& flock, Parameters const& pars,
+              Arena& arena)
 {
   assert(boid.is_pred());
   if (pars.get_seek_type() == 2) {
-    return cohesion(boid, flock, pars);
+    return cohesion(boid, flock, pars, arena);
   } else {
-    Boid prey{{}, {}};
-
-    switch (pars.get_seek_type()) {
-    case 0:
-      prey = find_prey(boid, flock, pars.get_angle());
-      break;
-    case 1:
-      prey = find_prey_isolated(boid, flock, pars.get_angle(),
-                                pars.get_d_s_pred());
-      break;
-    default:
-      break;
-    }
+    // the prey is referred to, not copied
+    Boid const& prey{(pars.get_seek_type() == 0)
+                         ? find_prey(boid, flock, pars.get_pred_angle())
+                         : find_prey_isolated(boid, flock,
+                                              pars.get_pred_angle(),
+                                              pars.get_d_s_pred(), arena)};
 
     if (prey.is_pred()) {
       // this means find_prey returned boid itself (i.e. no preys in sight)
       return {0., 0.};
     }
-    if (in_corner(prey, pars.get_x_max(), pars.get_y_max())) {
-      // corners represent preys' refuge
+    if (!pars.get_periodic()
+        && in_corner(prey, pars.get_x_max(), pars.get_y_max())) {
+      // corners represent preys' refuge (a periodic world has none)
       return {0., 0.};
     }
 
-    auto pos_diff{prey.position() - boid.position()};
+    // in a periodic world the prey is chased through the nearest border
+    Position const prey_position{
+        pars.get_periodic()
+            ? nearest_image(prey, boid.position(), pars.get_x_min(),
+                            pars.get_x_max(), pars.get_y_min(),
+                            pars.get_y_max())
+                  .position()
+            : prey.position()};
+    auto pos_diff{prey_position - boid.position()};
     // Predators' look-ahead feature allows them to take into
     // account the current velocity of prey in addition to its position.
     Velocity vel{pos_diff.x() + prey.velocity().x(),
@@ -309,38 +650,247 @@ Velocity seek(Boid const& boid, Flock const& flock, Parameters const& pars)
   }
 }
 
-Boid Flock::solve(Boid const& boid, Parameters const& pars) const
+// rules called without an arena use the one of the calling thread, which is
+// rewound as soon as they return (unless an outer Scope is alive)
+Velocity separation(Boid const& boid, Flock const& flock,
+                    Parameters const& pars)
+{
+  Arena& arena{thread_arena()};
+  Arena::Scope scope{arena};
+  return separation(boid, flock, pars, arena);
+}
+Velocity alignment(Boid const& boid, Flock const& flock, Parameters const& pars)
+{
+  Arena& arena{thread_arena()};
+  Arena::Scope scope{arena};
+  return alignment(boid, flock, pars, arena);
+}
+Velocity cohesion(Boid const& boid, Flock const& flock, Parameters const& pars)
+{
+  Arena& arena{thread_arena()};
+  Arena::Scope scope{arena};
+  return cohesion(boid, flock, pars, arena);
+}
+Velocity seek(Boid const& boid, Flock const& flock, Parameters const& pars)
+{
+  Arena& arena{thread_arena()};
+  Arena::Scope scope{arena};
+  return seek(boid, flock, pars, arena);
+}
+
+// position at the end of a step lasting d_t, given position and velocity at
+// its start and the velocity at its end (before bound_position is applied)
+Position integrate(Boid const& boid, Velocity v_f, double d_t,
+                   Parameters const& pars)
+{
+  Position const& x{boid.position()};
+  Velocity const& v{boid.velocity()};
+  switch (pars.get_integrator()) {
+  case Integrator::semi_implicit:
+    // speed limits are applied first, so that no boid moves faster than
+    // max_speed
+    normalize(v_f, pars.get_min_speed(), pars.get_max_speed());
+    return {x.x() + (v_f.x() * d_t), x.y() + (v_f.y() * d_t)};
+  case Integrator::verlet:
+    normalize(v_f, pars.get_min_speed(), pars.get_max_speed());
+    return {x.x() + (.5 * (v.x() + v_f.x()) * d_t),
+            x.y() + (.5 * (v.y() + v_f.y()) * d_t)};
+  case Integrator::euler:
+  default:
+    return {x.x() + (v.x() * d_t), x.y() + (v.y() * d_t)};
+  }
+}
+
+Boid Flock::solve(Boid const& boid, Parameters const& pars, double d_t) const
 {
   if (boid.is_eaten()) { // if boid is eaten, new state is not calculated
     return boid;
   } else {
+    // temporaries of the rules are taken from the thread's arena, which is
+    // rewound when this boid's update is done
+    Arena& arena{thread_arena()};
+    Arena::Scope scope{arena};
     // different flying rules for predator vs. regular boid
-    Velocity d_v{(boid.is_pred())
-                     ? (separation(boid, *this, pars) + seek(boid, *this, pars))
-                     : (separation(boid, *this, pars)
-                        + alignment(boid, *this, pars)
-                        + cohesion(boid, *this, pars))};
-    Velocity v_f{boid.velocity() + d_v};
-    double const d_t{pars.get_duration() / pars.get_steps()};
-    assert(d_t > 0.);
-    Position x_f{boid.position().x() + (boid.velocity().x() * d_t),
-                 boid.position().y() + (boid.velocity().y() * d_t)};
-    Boid b_f{(boid.is_pred()) ? Boid{x_f, v_f, true} : Boid{x_f, v_f}};
-    // Boid returned from solve is always "valid", i.e bound_position has been
-    // applied and speed is within limits:
+    Velocity d_v{(boid.is_pred()) ? (separation(boid, *this, pars, arena)
+                                     + seek(boid, *this, pars, arena))
+                                  : (separation(boid, *this, pars, arena)
+                                     + alignment(boid, *this, pars, arena)
+                                     + cohesion(boid, *this, pars, arena))};
+    return update(boid, d_v, pars, d_t);
+  }
+}
+
+Boid update(Boid const& boid, Velocity d_v, Parameters const& pars, double d_t)
+{
+  assert(d_t > 0.);
+  // flying rules give the velocity change over a step of duration/steps: a
+  // longer (or shorter) step changes velocity proportionally. Not so for a
+  // predator's longer step: seek steers towards a target velocity, and more
+  // than a base step's change would overshoot it
+  double const d_t_base{pars.get_duration() / pars.get_steps()};
+  if (d_t != d_t_base) {
+    d_v *= boid.is_pred() ? std::min(d_t / d_t_base, 1.) : d_t / d_t_base;
+  }
+  Velocity v_f{boid.velocity() + d_v};
+  Position x_f{integrate(boid, v_f, d_t, pars)};
+  Boid b_f{(boid.is_pred()) ? Boid{x_f, v_f, true} : Boid{x_f, v_f}};
+  // Boid returned from solve is always "valid", i.e bound_position has been
+  // applied (or, in a periodic world, its position wrapped into the box) and
+  // speed is within limits:
+  if (pars.get_periodic()) {
+    wrap_position(b_f, pars.get_x_min(), pars.get_x_max(), pars.get_y_min(),
+                  pars.get_y_max());
+  } else {
     bound_position(b_f, pars.get_x_min(), pars.get_x_max(), pars.get_y_min(),
                    pars.get_y_max());
-    normalize(b_f.velocity(), pars.get_min_speed(), pars.get_max_speed());
-    return b_f;
   }
+  normalize(b_f.velocity(), pars.get_min_speed(), pars.get_max_speed());
+  return b_f;
+}
+
+void Flock::refresh_predators()
+{
+  preds_x_.resize(preds_.size());
+  preds_y_.resize(preds_.size());
+  for (int k{0}; k != static_cast<int>(preds_.size()); ++k) {
+    preds_x_[k] = flock_[preds_[k]].position().x();
+    preds_y_[k] = flock_[preds_[k]].position().y();
+  }
+}
+
+void Flock::sync_predators()
+{
+  int kept{0};
+  for (int k{0}; k != static_cast<int>(preds_.size()); ++k) {
+    if (flock_[preds_[k]].is_pred()) {
+      preds_[kept]    = preds_[k];
+      captures_[kept] = captures_[k];
+      ++kept;
+    }
+  }
+  preds_.resize(kept);
+  captures_.resize(kept);
+  // the registered slots are all distinct: if they are as many as the
+  // predators, every predator is registered
+  if (std::count_if(flock_.begin(), flock_.end(),
+                    [](Boid const& b) { return b.is_pred(); })
+      != kept) {
+    std::vector<bool> registered(flock_.size(), false);
+    for (int i : preds_) {
+      registered[i] = true;
+    }
+    for (int i{0}; i != size(); ++i) {
+      if (flock_[i].is_pred() && !registered[i]) {
+        preds_.push_back(i);
+        captures_.push_back(0);
+      }
+    }
+  }
+  refresh_predators();
 }
 
 void Flock::evolve(Parameters const& pars)
+{
+  evolve(pars, pars.get_duration() / pars.get_steps());
+}
+
+void Flock::evolve(Parameters const& pars, double d_t)
+{
+  auto const start{std::chrono::steady_clock::now()};
+  advance(pars, d_t);
+  capture(pars);
+  if (pars.get_engine() == Engine::automatic) {
+    // NB time points are not subtracted directly: the call would be ambiguous
+    // with boids.hpp's operator- template
+    auto const ticks{std::chrono::steady_clock::now().time_since_epoch().count()
+                     - start.time_since_epoch().count()};
+    time_engine(static_cast<double>(ticks));
+  }
+  end_step(pars);
+}
+
+// the new states take the place of the oldest ones, as in advance
+void Flock::evolve(Parameters const& pars, std::vector<Boid>& next)
+{
+  assert(next.size() == flock_.size());
+  previous_.swap(next);
+  flock_.swap(previous_);
+  sync_predators();
+  if (grid_.built()) {
+    grid_.clear();
+  }
+  capture(pars);
+  end_step(pars);
+}
+
+void Flock::end_step(Parameters const& pars)
+{
+  if (log_ != nullptr) {
+    log_->end_step(counter_);
+  }
+  ++step_;
+  if (pars.get_reorder_interval() > 0
+      && step_ % pars.get_reorder_interval() == 0) {
+    reorder(pars);
+  }
+}
+
+void Flock::advance(Parameters const& pars, double d_t)
 {
   assert(this->size() > 1);
-  std::vector<Boid> state_f{};
+  // boids may have been moved or placed through state() since the last step
+  sync_predators();
+  engine_ = (pars.get_engine() == Engine::automatic) ? select_engine(pars)
+                                                     : pars.get_engine();
+  // the indices of a periodic world hold the ghost images too: they are built
+  // for this step only
+  bool const periodic{pars.get_periodic()};
+  if (periodic) {
+    build_images(pars);
+  }
+  std::vector<Boid> const& boids{images()};
+  // the grid is built when its engine is selected or far-field sums are used,
+  // then kept in sync by update, capture and reorder. Cells are as wide as the
+  // neighbour distance, or a fraction of it if they are summed over. In a
+  // periodic world the ghost images are held in a ring of ghost cells around
+  // the box
+  bool const far_field{pars.get_far_field()};
+  if (engine_ == Engine::grid || far_field) {
+    double const cell_size{far_field ? pars.get_d() / Grid::far_field_split
+                                     : pars.get_d()};
+    if (periodic || !grid_.built() || grid_.cell_size() != cell_size
+        || grid_.aggregated() != far_field) {
+      grid_.rebuild(boids, pars, cell_size, far_field,
+                    periodic ? reach_ : 0.);
+    }
+  } else if (grid_.built()) {
+    grid_.clear();
+  }
+  // a quadtree adapts to the current positions: it is cheaper to build it
+  // anew than to rebalance it
+  if (engine_ == Engine::quadtree) {
+    tree_.build(boids, pars);
+  }
+  // candidates cover every distance neighbours() is called with
+  if (engine_ == Engine::tiled) {
+    tiles_.build(boids,
+                 std::max({pars.get_d(), pars.get_d_s(), pars.get_d_s_pred()}),
+                 pars.get_angle());
+  }
+  view_culling_ = pars.get_view_culling();
+  // new states are written to the buffer holding the states before the
+  // previous step, which is reused instead of allocating a new vector
+  std::vector<Boid>& state_f{previous_};
+  state_f.clear();
   std::transform(flock_.begin(), flock_.end(), std::back_inserter(state_f),
-                 [&](Boid const& boid) { return solve(boid, pars); });
+                 [&](Boid const& boid) { return solve(boid, pars, d_t); });
+  tree_.clear();
+  tiles_.clear();
+  if (periodic) {
+    grid_.clear();
+    images_.clear();
+    ghost_preds_.clear();
+  }
   // asserting that vectors have same size, that boids' is_pred attribute is
   // unchanged for all and that order was left unaltered
   assert(flock_.size() == state_f.size());
@@ -350,39 +900,300 @@ void Flock::evolve(Parameters const& pars)
                     }));
   // overwriting only when all new states have been calculated (instead of
   // using flock_ as the output range in std::transform) to prevent an old
-  // boid's state from being calculated with an already updated boid
-  flock_ = state_f;
-  std::for_each(flock_.begin(), flock_.end(),
-                [&](Boid const& boid) { set_victims(boid, *this, pars); });
+  // boid's state from being calculated with an already updated boid. After
+  // the swap previous_ holds the states before this step
+  flock_.swap(state_f);
+  refresh_predators();
+  if (grid_.built()) {
+    grid_.update(flock_);
+  }
+}
+
+double ghost_reach(Parameters const& pars)
+{
+  double const d{pars.get_far_field()
+                     ? (1. + pars.get_far_field_tolerance()) * pars.get_d()
+                     : pars.get_d()};
+  return std::max({d, pars.get_d_s(), pars.get_d_s_pred()});
+}
+
+// a boid within reach of a border gets an image across the opposite one, and
+// one across the opposite corner if it is within reach of two borders. Images
+// are moved by whole box sides, as by nearest_image, so the ghost image of a
+// boid and its nearest image to a boid in the box coincide. Eaten boids are
+// never selected, and get none
+void Flock::build_images(Parameters const& pars)
+{
+  box_ = {pars.get_x_min(), pars.get_x_max(), pars.get_y_min(),
+          pars.get_y_max()};
+  reach_ = ghost_reach(pars);
+  double const width{box_[1] - box_[0]};
+  double const height{box_[3] - box_[2]};
+  assert(2. * reach_ < std::min(width, height));
+  // widened, to absorb the rounding of the moved coordinates
+  double const band{reach_ * (1. + 1e-9)};
+  images_.assign(flock_.begin(), flock_.end());
+  ghost_preds_.clear();
+  for (Boid const& b : flock_) {
+    if (b.is_eaten()) {
+      continue;
+    }
+    double const x{b.position().x()};
+    double const y{b.position().y()};
+    double const shift_x{(x - box_[0] <= band)   ? width
+                         : (box_[1] - x <= band) ? -width
+                                                 : 0.};
+    double const shift_y{(y - box_[2] <= band)   ? height
+                         : (box_[3] - y <= band) ? -height
+                                                 : 0.};
+    auto const add{[&](double dx, double dy) {
+      Boid image{b};
+      image.position().x() += dx;
+      image.position().y() += dy;
+      if (image.is_pred()) {
+        ghost_preds_.push_back(static_cast<int>(images_.size()));
+      }
+      images_.push_back(image);
+    }};
+    if (shift_x != 0.) {
+      add(shift_x, 0.);
+    }
+    if (shift_y != 0.) {
+      add(0., shift_y);
+    }
+    if (shift_x != 0. && shift_y != 0.) {
+      add(shift_x, shift_y);
+    }
+  }
+}
+
+namespace {
+// engines worth timing for the flock. Brute force is only tried for small
+// flocks and the spatial indices only for large ones; the tiled engine is
+// tried while the candidates of all boids (their expected number, from the
+// share of the box within the neighbour distance) fit in a few MB
+std::vector<Engine> engine_candidates(int size, Parameters const& pars)
+{
+  double const box{(pars.get_x_max() - pars.get_x_min())
+                   * (pars.get_y_max() - pars.get_y_min())};
+  double const share{std::min(pi * pars.get_d() * pars.get_d() / box, 1.)};
+  double const pairs{share * size * size};
+  std::vector<Engine> engines;
+  if (size <= 1000) {
+    engines.push_back(Engine::brute_force);
+  }
+  if (pairs <= 4e6) {
+    engines.push_back(Engine::tiled);
+  }
+  if (size >= 250 || engines.empty()) {
+    engines.push_back(Engine::grid);
+    engines.push_back(Engine::quadtree);
+  }
+  return engines;
+}
+} // namespace
+
+Engine Flock::select_engine(Parameters const& pars)
+{
+  if (trials_.empty() && step_ >= next_trial_) {
+    trials_ = engine_candidates(size(), pars);
+    std::reverse(trials_.begin(), trials_.end());
+    fastest_time_ = std::numeric_limits<double>::infinity();
+    trial_time_   = 0.;
+    trial_steps_  = 0;
+    next_trial_   = step_ + trial_interval;
+  }
+  return trials_.empty() ? fastest_ : trials_.back();
+}
+
+// the first step of an engine (e.g. building the grid) is timed too: it is
+// paid again whenever the engine is switched to
+void Flock::time_engine(double time)
+{
+  if (trials_.empty()) {
+    return;
+  }
+  trial_time_ += time;
+  if (++trial_steps_ == trial_steps) {
+    if (trial_time_ < fastest_time_) {
+      fastest_      = trials_.back();
+      fastest_time_ = trial_time_;
+    }
+    trials_.pop_back();
+    trial_time_  = 0.;
+    trial_steps_ = 0;
+  }
+}
+
+namespace {
+// spreads the 16 lower bits of v to the even bits of the result
+std::uint32_t spread(std::uint32_t v)
+{
+  v &= 0x0000FFFF;
+  v = (v | (v << 8)) & 0x00FF00FF;
+  v = (v | (v << 4)) & 0x0F0F0F0F;
+  v = (v | (v << 2)) & 0x33333333;
+  v = (v | (v << 1)) & 0x55555555;
+  return v;
+}
+
+// maps v to one of 2^16 intervals splitting [min, max]
+std::uint32_t quantize(double v, double min, double max)
+{
+  return static_cast<std::uint32_t>(std::clamp((v - min) / (max - min), 0., 1.)
+                                    * 65535.);
+}
+} // namespace
+
+// interleaving the bits of the quantized coordinates, points in the same
+// quadrant (at any scale) get contiguous codes. Boids slightly out of the box
+// (bound_position only steers them back) are clamped to its border
+std::uint32_t morton(Position const& p, Parameters const& pars)
+{
+  return spread(quantize(p.x(), pars.get_x_min(), pars.get_x_max()))
+       | (spread(quantize(p.y(), pars.get_y_min(), pars.get_y_max())) << 1);
+}
+
+// moves every boid to its slot along the curve (ties broken by id, so that the
+// order does not depend on the previous one). States before the last step are
+// moved along, and predators keep their order of registration, so that
+// capture priorities are unchanged
+void Flock::reorder(Parameters const& pars)
+{
+  // predators placed through state() are registered before slots change
+  sync_predators();
+  keys_.clear();
+  for (int i{0}; i != size(); ++i) {
+    keys_.push_back({morton(flock_[i].position(), pars), ids_[i]});
+  }
+  std::sort(keys_.begin(), keys_.end());
+  auto permute{[&](std::vector<Boid>& boids) {
+    spare_.clear();
+    for (auto const& key : keys_) {
+      spare_.push_back(boids[slots_[key.second]]);
+    }
+    boids.swap(spare_);
+  }};
+  permute(flock_);
+  if (previous_.size() == flock_.size()) {
+    permute(previous_);
+  }
+  for (int& pred : preds_) {
+    pred = ids_[pred];
+  }
+  for (int i{0}; i != size(); ++i) {
+    ids_[i]         = keys_[i].second;
+    slots_[ids_[i]] = i;
+  }
+  for (int& pred : preds_) {
+    pred = slots_[pred];
+  }
+  if (grid_.built()) {
+    grid_.rebuild(flock_, pars, grid_.cell_size(), grid_.aggregated());
+  }
+}
+
+// same outcome as calling set_victims for every boid in flock order, but
+// preys are checked in parallel. Gather: every prey independently finds the
+// first predator (in flock order) it is a victim of. Resolve: claims are
+// applied serially, so that each prey is counted once and always credited to
+// the same predator, however the gather was scheduled
+void Flock::capture(Parameters const& pars)
+{
+  int const n_preds{static_cast<int>(preds_.size())};
+  claims_.assign(flock_.size(), n_preds); // n_preds stands for "no claim"
+  claim_times_.assign(flock_.size(), 1.);
+  // swept test needs the states before the step, i.e. a step was performed
+  bool const swept{pars.get_swept_capture()
+                   && previous_.size() == flock_.size()};
+  parallel_for(0, size(), [&](int j) {
+    for (int k{0}; k != n_preds; ++k) {
+      int const i{preds_[k]};
+      if (swept) {
+        std::optional<double> const t{
+            is_victim(previous_[i], flock_[i], previous_[j], flock_[j], pars)};
+        if (t) {
+          claims_[j]      = k;
+          claim_times_[j] = *t;
+          break;
+        }
+      } else if (is_victim(flock_[i], flock_[j], pars)) {
+        claims_[j] = k;
+        break;
+      }
+    }
+  });
+  for (int j{0}; j != size(); ++j) {
+    if (claims_[j] != n_preds) {
+      flock_[j].is_eaten() = true;
+      grid_.remove(flock_, j);
+      ++counter_;
+      ++captures_[claims_[j]];
+      if (log_ != nullptr) {
+        int const i{preds_[claims_[j]]};
+        if (claim_times_[j] < 1.) {
+          // a swept capture is logged as it happened, at the closest approach
+          auto const [r0, dr]{relative_motion(previous_[i], flock_[i],
+                                              previous_[j], flock_[j], pars)};
+          auto [pred, prey]{states_at(claim_times_[j], previous_[i],
+                                      flock_[i], flock_[j], r0, dr)};
+          double const gap{distance(pred, prey)};
+          if (pars.get_periodic()) {
+            wrap_position(prey, pars.get_x_min(), pars.get_x_max(),
+                          pars.get_y_min(), pars.get_y_max());
+          }
+          log_->record({step_, ids_[i], ids_[j], prey.position(), gap});
+        } else {
+          Boid const& pred{flock_[i]};
+          Boid const prey{pars.get_periodic()
+                              ? nearest_image(flock_[j], pred.position(),
+                                              pars.get_x_min(),
+                                              pars.get_x_max(),
+                                              pars.get_y_min(),
+                                              pars.get_y_max())
+                              : flock_[j]};
+          log_->record({step_, ids_[i], ids_[j], flock_[j].position(),
+                        distance(pred, prey)});
+        }
+      }
+    }
+  }
+}
+
+// draws the initial state of the counter-th boid of a stream. The four
+// coordinates come from a single Philox block, so boids are independent of
+// each other and can be generated in any order
+Boid random_boid(Philox const& gen, int counter, Parameters const& pars,
+                 bool is_pred)
+{
+  auto const bits{gen(static_cast<std::uint64_t>(counter))};
+  double const v_lim{pars.get_max_speed() / sqrt2};
+  Position p{uniform(bits[0], pars.get_x_min(), pars.get_x_max()),
+             uniform(bits[1], pars.get_y_min(), pars.get_y_max())};
+  Velocity v{uniform(bits[2], -v_lim, v_lim), uniform(bits[3], -v_lim, v_lim)};
+  // range defined above does not ensure by itself that speed limits are
+  // respected
+  normalize(v, pars.get_min_speed(), pars.get_max_speed());
+  return is_pred ? Boid{p, v, true} : Boid{p, v};
 }
 
 // fills empty vector with N_boids with randomly generated positions and
-// velocities (respecting limits of space and speed)
+// velocities (respecting limits of space and speed). The boids of simulation
+// [simulation] in the batch identified by [seed] are always the same, no
+// matter which other simulations were run
 std::vector<Boid>& fill(std::vector<Boid>& boids, Parameters const& pars,
-                        unsigned int seed)
+                        unsigned int seed, int simulation)
 {
   assert(pars.get_N_boids() > 1);
   assert(boids.empty());
+  assert(simulation >= 0);
 
-  // generates random unsigned ints
-  std::default_random_engine eng(seed);
-  // transforms the random unsigned int generated by gen into a
-  //  double in [min, max).
-  std::uniform_real_distribution<double> unidist_px(pars.get_x_min(),
-                                                    pars.get_x_max());
-  std::uniform_real_distribution<double> unidist_py(pars.get_y_min(),
-                                                    pars.get_y_max());
-  std::uniform_real_distribution<double> unidist_v(
-      -pars.get_max_speed() / sqrt2, pars.get_max_speed() / sqrt2);
-
-  std::generate_n(std::back_inserter(boids), pars.get_N_boids(), [&]() {
-    return Boid{{unidist_px(eng), unidist_py(eng)},
-                {unidist_v(eng), unidist_v(eng)}};
-  });
-  // range defined above does not ensure by itself that speed limits are
-  // respected
-  std::for_each(boids.begin(), boids.end(), [&](Boid& b) {
-    normalize(b.velocity(), pars.get_min_speed(), pars.get_max_speed());
+  Philox const gen{seed, static_cast<std::uint32_t>(simulation),
+                   Stream::preys};
+  boids.assign(pars.get_N_boids(), Boid{{}, {}});
+  // no boid depends on another, so huge flocks are generated in parallel
+  parallel_for(0, pars.get_N_boids(), [&](int i) {
+    boids[i] = random_boid(gen, i, pars, false);
   });
 
   int size = boids.size();
@@ -395,21 +1206,17 @@ std::vector<Boid>& fill(std::vector<Boid>& boids, Parameters const& pars,
   return boids;
 }
 
-void add_predators(Flock& flock, Parameters const& pars, unsigned int seed)
+// predators are drawn from their own stream: their positions are not
+// correlated with the ones of the first regular boids
+void add_predators(Flock& flock, Parameters const& pars, unsigned int seed,
+                   int simulation)
 {
-  std::default_random_engine eng(seed);
-  std::uniform_real_distribution<double> unidist_px(pars.get_x_min(),
-                                                    pars.get_x_max());
-  std::uniform_real_distribution<double> unidist_py(pars.get_y_min(),
-                                                    pars.get_y_max());
-  std::uniform_real_distribution<double> unidist_v(
-      -pars.get_max_speed() / sqrt2, pars.get_max_speed() / sqrt2);
+  assert(simulation >= 0);
+  Philox const gen{seed, static_cast<std::uint32_t>(simulation),
+                   Stream::predators};
   for (int i{0}; i != pars.get_N_preds(); ++i) {
     int init_size{flock.size()};
-    Boid boid{{unidist_px(eng), unidist_py(eng)},
-              {unidist_v(eng), unidist_v(eng)},
-              true};
-    normalize(boid.velocity(), pars.get_min_speed(), pars.get_max_speed());
+    Boid boid{random_boid(gen, i, pars, true)};
     assert(norm(boid.velocity()) > pars.get_min_speed()
            && norm(boid.velocity()) < pars.get_max_speed());
     assert(boid.is_pred());
@@ -418,10 +1225,128 @@ void add_predators(Flock& flock, Parameters const& pars, unsigned int seed)
   }
 }
 
-// evolves flock for [steps] times
-void simulate(Flock& flock, Parameters const& pars)
+// length of the next step when steps are adaptive: duration/steps times a
+// power of 2, from min_step_factor to max_step_factor. A step is shortened
+// below duration/steps while, within a base step,
+// - a predator could get within capture radius of a prey, if both flew
+//   straight towards each other at max_speed
+// - a boid could reach the band where bound_position kicks in (a periodic
+//   world has no walls, and distances are the ones of nearest images)
+// and lengthened only while neither can happen during the longer step and
+// velocities changed by less than a small fraction of max_speed during the
+// previous step, i.e. the flock is cruising. Close chases and walls are so
+// integrated at a finer resolution than the base one
+double Flock::next_step(Parameters const& pars) const
+{
+  double const tolerance{.02}; // on velocity change, relative to max_speed
+  double const d_t_base{pars.get_duration() / pars.get_steps()};
+  double const max_speed{pars.get_max_speed()};
+
+  bool const periodic{pars.get_periodic()};
+  double min_dist{pars.get_x_max() + pars.get_y_max()};
+  for (int i : preds_) {
+    for (Boid const& b : flock_) {
+      if (!(b.is_pred()) && !(b.is_eaten())) {
+        Position const& p{flock_[i].position()};
+        min_dist = std::min(
+            min_dist, periodic ? distance(flock_[i],
+                                          nearest_image(b, p, pars.get_x_min(),
+                                                        pars.get_x_max(),
+                                                        pars.get_y_min(),
+                                                        pars.get_y_max()))
+                               : distance(flock_[i], b));
+      }
+    }
+  }
+  double const capture_gap{min_dist - pars.get_d_s_pred() / 24.5};
+
+  // bound_position acts within .015 * max of the borders
+  double const x_low{pars.get_x_min() + .015 * pars.get_x_max()};
+  double const x_high{pars.get_x_max() - .015 * pars.get_x_max()};
+  double const y_low{pars.get_y_min() + .015 * pars.get_y_max()};
+  double const y_high{pars.get_y_max() - .015 * pars.get_y_max()};
+  double wall_gap{pars.get_x_max() + pars.get_y_max()};
+  double max_dv{0.};
+  for (int j{0}; j != size(); ++j) {
+    Boid const& b{flock_[j]};
+    if (b.is_eaten()) {
+      continue;
+    }
+    if (!periodic) {
+      wall_gap = std::min({wall_gap, b.position().x() - x_low,
+                           x_high - b.position().x(), b.position().y() - y_low,
+                           y_high - b.position().y()});
+    }
+    if (previous_.size() == flock_.size()) {
+      max_dv = std::max(max_dv, norm(b.velocity() - previous_[j].velocity()));
+    }
+  }
+  if (previous_.size() != flock_.size()) {
+    max_dv = max_speed; // nothing is known yet about velocity changes
+  }
+
+  // whether no capture and no wall can be reached within a step of factor
+  // times the base one
+  auto const clear{[&](double factor) {
+    double const next_t{factor * d_t_base};
+    return 2. * max_speed * next_t < capture_gap
+        && max_speed * next_t < wall_gap;
+  }};
+  double factor{1.};
+  if (!clear(factor)) {
+    while (factor > min_step_factor && !clear(factor)) {
+      factor /= 2.;
+    }
+    return factor * d_t_base;
+  }
+  while (factor < max_step_factor && clear(2. * factor)
+         && 2. * factor * max_dv < tolerance * max_speed) {
+    factor *= 2.;
+  }
+  return factor * d_t_base;
+}
+
+std::vector<Boid> warm_start(Parameters const& pars, unsigned int seed,
+                             int snapshot, int steps)
 {
-  for (int step = 0; step != pars.get_steps(); ++step) {
+  is_greater_than(steps, -1, "formation steps");
+  std::vector<Boid> boids{};
+  Flock flock{fill(boids, pars, seed, snapshot)};
+  for (int step{0}; step != steps; ++step) {
     flock.evolve(pars);
   }
+  return flock.state();
+}
+
+// evolves flock for [steps] times or, with adaptive steps, until duration is
+// reached. Returns the number of steps performed
+int simulate(Flock& flock, Parameters const& pars)
+{
+  if (!pars.get_adaptive_steps()) {
+    for (int step = 0; step != pars.get_steps(); ++step) {
+      flock.evolve(pars);
+    }
+    return pars.get_steps();
+  }
+  double const d_t_base{pars.get_duration() / pars.get_steps()};
+  int steps{0};
+  double time{0.};
+  // half the shortest step of slack absorbs rounding in the sum of the steps
+  while (time < pars.get_duration() - .5 * Flock::min_step_factor * d_t_base) {
+    double const d_t{
+        std::min(flock.next_step(pars), pars.get_duration() - time)};
+    flock.evolve(pars, d_t);
+    time += d_t;
+    ++steps;
+  }
+  return steps;
+}
+
+Flock run_simulation(Parameters const& pars, unsigned int seed, int simulation)
+{
+  std::vector<Boid> boids{};
+  Flock flock{fill(boids, pars, seed, simulation)};
+  add_predators(flock, pars, seed, simulation);
+  simulate(flock, pars);
+  return flock;
 }
@@ -1,7 +1,18 @@
 #ifndef FLOCK_HPP
 #define FLOCK_HPP
+#include "arena.hpp"
 #include "boids.hpp"
+#include "capture_log.hpp"
+#include "grid.hpp"
 #include "parameters.hpp"
+#include "quadtree.hpp"
+#include "tiles.hpp"
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <numeric>
+#include <optional>
+#include <utility>
 #include <vector>
 
 // defining class Flock, declaring flocks' flying rules, declaring functions
@@ -10,8 +21,70 @@
 class Flock
 {
   std::vector<Boid> flock_;
-  Boid solve(Boid const& boid, Parameters const& pars) const;
+  Boid solve(Boid const& boid, Parameters const& pars, double d_t) const;
   int counter_{0};
+  // indices in flock_ of the predators, in order of registration (i.e. flock
+  // order, unless the flock was reordered)
+  std::vector<int> preds_;
+  // predators' coordinates (same order as preds_), refreshed once per step.
+  // Predator-facing queries read them from these contiguous arrays instead of
+  // scanning the whole flock
+  std::vector<double> preds_x_;
+  std::vector<double> preds_y_;
+  void refresh_predators();
+  // preys captured by each predator (same order as preds_)
+  std::vector<int> captures_;
+  // scratch space of capture, reused at every step: the predator claiming
+  // each boid, and the time of the claim as a fraction of the step
+  std::vector<int> claims_;
+  std::vector<double> claim_times_;
+  // states before the last step (empty if no step was performed)
+  std::vector<Boid> previous_;
+  // stable id (index at creation) of the boid in each slot of flock_, and slot
+  // of each id. Slot and id differ only once the flock has been reordered
+  std::vector<int> ids_;
+  std::vector<int> slots_;
+  // scratch space of reorder: (position along the curve, id) of every boid,
+  // and the boids in their new order
+  std::vector<std::pair<std::uint32_t, int>> keys_;
+  std::vector<Boid> spare_;
+  // index of alive regular boids, maintained while the grid engine is in use
+  Grid grid_;
+  // index of alive regular boids, built at the start of every step while the
+  // quadtree engine is in use and dropped once the new states are computed
+  Quadtree tree_;
+  // candidates of every boid, built like the quadtree while the tiled engine
+  // is in use
+  Tiles tiles_;
+  // engine of the last step. With Engine::automatic, the engines suited to the
+  // flock (see engine_candidates in flock.cpp) are timed for trial_steps steps
+  // each, and the fastest is used until they are timed again trial_interval
+  // steps later: the best engine changes as the flock clusters
+  Engine engine_{Engine::brute_force};
+  std::vector<Engine> trials_; // engines yet to be timed, next one last
+  Engine fastest_{Engine::brute_force};
+  double fastest_time_{0.}; // in clock ticks
+  double trial_time_{0.};
+  int trial_steps_{0}; // steps timed for the engine on trial
+  int next_trial_{0};  // step at which engines are timed again
+  Engine select_engine(Parameters const& pars);
+  void time_engine(double time);
+  // whether the indices are searched within the field of view only, as set by
+  // the parameters of the last step
+  bool view_culling_{true};
+  // while a step of a periodic world is computed: the boids, followed by the
+  // ghost images of the ones within reach_ of a border (copies moved by a box
+  // side across the opposite border). Empty otherwise
+  std::vector<Boid> images_;
+  std::vector<int> ghost_preds_; // indices in images_ of the ghost predators
+  double reach_{0.};
+  std::array<double, 4> box_{}; // x_min, x_max, y_min, y_max
+  void build_images(Parameters const& pars);
+  // logging, counting and reordering that close every step
+  void end_step(Parameters const& pars);
+  int step_{0}; // evolutions performed
+  // optional record of the captures, not owned (nullptr when disabled)
+  Capture_log* log_{nullptr};
 
  public:
   explicit Flock(std::vector<Boid> const& flock)
@@ -19,49 +92,190 @@ class Flock
   {
     // parameter N_boids was verified by the constructor of Parameters to be > 1
     assert(flock_.size() > 1);
+    for (int i{0}; i != size(); ++i) {
+      if (flock_[i].is_pred()) {
+        preds_.push_back(i);
+      }
+    }
+    captures_.assign(preds_.size(), 0);
+    ids_.resize(flock_.size());
+    std::iota(ids_.begin(), ids_.end(), 0);
+    slots_ = ids_;
+    refresh_predators();
   }
   // clang-format off
   bool empty() const{ return flock_.empty(); }
   //NB not risking narrowing with int as return type since parameter N_boids is an int
   int size() const { return flock_.size(); }
   std::vector<Boid> const& state() const { return flock_; }
+  // NB boids moved or placed through state() are seen at their new position
+  // by the grid only after the next step, and by predators() and
+  // competitors() after the next step or sync_predators()
   std::vector<Boid>& state() { return flock_; }
   int counter() const {return counter_;}
   int& counter() {return counter_;}
+  std::vector<int> const& captures() const {return captures_;}
+  std::vector<int>& captures() {return captures_;}
+  std::vector<int> const& pred_indices() const {return preds_;}
+  std::vector<double> const& preds_x() const {return preds_x_;}
+  std::vector<double> const& preds_y() const {return preds_y_;}
+  int step() const {return step_;}
+  // id of the boid in slot [slot] of state(), and slot of the boid with id [id]
+  int id(int slot) const {return ids_[slot];}
+  int slot(int id) const {return slots_[id];}
+  Grid const& grid() const {return grid_;}
+  Quadtree const& tree() const {return tree_;}
+  Tiles const& tiles() const {return tiles_;}
+  Engine engine() const {return engine_;}
+  // index in state() of boid, -1 if boid is not one of its elements (e.g. a
+  // copy)
+  int index_of(Boid const& boid) const
+  {
+    std::less<Boid const*> const before{};
+    Boid const* const data{flock_.data()};
+    return (!before(&boid, data) && before(&boid, data + flock_.size()))
+             ? static_cast<int>(&boid - data)
+             : -1;
+  }
+  bool view_culling() const {return view_culling_;}
+  // boids queries select from: state(), followed by the ghost images of its
+  // boids while a step of a periodic world is computed. Ghost images are
+  // closer than half a box side to the box, so no boid sees both a boid and
+  // its image, and the ones it sees are at their nearest image
+  std::vector<Boid> const& images() const
+  {
+    return images_.empty() ? flock_ : images_;
+  }
+  bool periodic() const {return !images_.empty();}
+  std::vector<int> const& ghost_preds() const {return ghost_preds_;}
+  double reach() const {return reach_;}
+  std::array<double, 4> const& box() const {return box_;}
+  // NB copies of the flock write to the same log
+  void attach(Capture_log* log) {log_ = log;}
   void push_back(Boid const& boid) 
   {
     assert (!empty());
+    if (boid.is_pred()) {
+      preds_.push_back(size());
+      captures_.push_back(0);
+      preds_x_.push_back(boid.position().x());
+      preds_y_.push_back(boid.position().y());
+    }
+    ids_.push_back(size());
+    slots_.push_back(size());
     flock_.push_back(boid);
+    grid_.add(flock_, size() - 1);
   }
+  // registers the predators placed through state() after the ones already
+  // registered (whose order is kept), unregisters the slots no longer holding
+  // one and refreshes the predators' coordinates. Called by every step
+  void sync_predators();
+  static constexpr int trial_steps{3};
+  static constexpr int trial_interval{500};
+  // bounds of adaptive steps, relative to duration/steps (see next_step)
+  static constexpr double min_step_factor{.25};
+  static constexpr double max_step_factor{8.};
+  void capture(Parameters const& pars);
+  // evolves the flock by a step lasting duration/steps, or d_t
   void evolve(Parameters const& pars);
+  void evolve(Parameters const& pars, double d_t);
+  // evolves the flock by a step lasting duration/steps whose new states were
+  // computed elsewhere (see Lockstep): next holds them, and is left with
+  // unspecified contents. Captures are made as by evolve
+  void evolve(Parameters const& pars, std::vector<Boid>& next);
+  // first half of evolve: computes the new states of all boids, leaving
+  // captures to capture() (see simulate_decomposed)
+  void advance(Parameters const& pars, double d_t);
+  double next_step(Parameters const& pars) const;
+  // sorts boids along a Z-order curve, so that boids close in space are close
+  // in memory too. Ids are unchanged
+  void reorder(Parameters const& pars);
   // clang-format on
 };
 
-// flying rules' auxiliary functions
-std::vector<Boid>& neighbours(Boid const& boid, Flock const& flock,
-                              std::vector<Boid>& nbrs, double angle, double d);
-std::vector<Boid>& predators(Boid const& boid, Flock const& flock,
-                             std::vector<Boid>& preds, double angle,
-                             double d_s_pred);
-std::vector<Boid>& competitors(Boid const& boid, Flock const& flock,
-                               std::vector<Boid>& competitors, double angle,
-                               double d_s);
+// flying rules' auxiliary functions. Query functions fill a vector with the
+// indices in images() of the boids they select (either a plain vector or one
+// drawing memory from an Arena)
+std::vector<int>& neighbours(Boid const& boid, Flock const& flock,
+                             std::vector<int>& nbrs, double angle, double d);
+std::pmr::vector<int>& neighbours(Boid const& boid, Flock const& flock,
+                                  std::pmr::vector<int>& nbrs, double angle,
+                                  double d);
+std::vector<int>& predators(Boid const& boid, Flock const& flock,
+                            std::vector<int>& preds, double angle,
+                            double d_s_pred);
+std::pmr::vector<int>& predators(Boid const& boid, Flock const& flock,
+                                 std::pmr::vector<int>& preds, double angle,
+                                 double d_s_pred);
+std::vector<int>& competitors(Boid const& boid, Flock const& flock,
+                              std::vector<int>& competitors, double angle,
+                              double d_s);
+std::pmr::vector<int>& competitors(Boid const& boid, Flock const& flock,
+                                   std::pmr::vector<int>& competitors,
+                                   double angle, double d_s);
+// sums of positions and velocities of the neighbours of boid, and their number,
+// from the sums over the cells of an aggregated grid (see far_field in
+// flock.cpp)
+Grid::Sums far_field(Boid const& boid, Flock const& flock, double angle,
+                     double d, double tolerance);
 Boid const& find_prey(Boid const& boid, Flock const& flock, double angle);
-Boid find_prey_isolated(Boid const& boid, Flock const& flock, double angle,
-                        double dist);
+Boid const& find_prey_isolated(Boid const& boid, Flock const& flock,
+                               double angle, double dist);
+Boid const& find_prey_isolated(Boid const& boid, Flock const& flock,
+                               double angle, double dist, Arena& arena);
+bool is_victim(Boid const& predator, Boid const& regular,
+               Parameters const& pars);
+std::optional<double> is_victim(Boid const& pred_before, Boid const& predator,
+                                Boid const& regular_before,
+                                Boid const& regular, Parameters const& pars);
 void set_victims(Boid const& boid, Flock& flock, Parameters const& pars);
 
-// flying rules' functions
+// flying rules' functions. Their temporaries are taken from arena (which the
+// caller rewinds) or, if no arena is passed, from the thread's arena
 Velocity separation(Boid const& boid, Flock const& flock,
                     Parameters const& pars);
+Velocity separation(Boid const& boid, Flock const& flock,
+                    Parameters const& pars, Arena& arena);
 Velocity alignment(Boid const& boid, Flock const& flock,
                    Parameters const& pars);
+Velocity alignment(Boid const& boid, Flock const& flock, Parameters const& pars,
+                   Arena& arena);
 Velocity cohesion(Boid const& boid, Flock const& flock, Parameters const& pars);
+Velocity cohesion(Boid const& boid, Flock const& flock, Parameters const& pars,
+                  Arena& arena);
 Velocity seek(Boid const& boid, Flock const& flock, Parameters const& pars);
+Velocity seek(Boid const& boid, Flock const& flock, Parameters const& pars,
+              Arena& arena);
+
+Position integrate(Boid const& boid, Velocity v_f, double d_t,
+                   Parameters const& pars);
+// new state of a boid whose velocity the flying rules change by d_v (as given
+// for a step of duration/steps) during a step lasting d_t
+Boid update(Boid const& boid, Velocity d_v, Parameters const& pars, double d_t);
+
+// distance within which boids see each other across the borders of a periodic
+// world: the longest one of the rules
+double ghost_reach(Parameters const& pars);
+
+// position of p along a Z-order (Morton) curve filling the box of pars
+std::uint32_t morton(Position const& p, Parameters const& pars);
 
+// simulation is the index of the simulation within the batch identified by seed
 std::vector<Boid>& fill(std::vector<Boid>& boids, Parameters const& pars,
-                        unsigned int seed);
-void add_predators(Flock& flock, Parameters const& pars, unsigned int seed);
-void simulate(Flock& flock, Parameters const& pars);
+                        unsigned int seed, int simulation = 0);
+void add_predators(Flock& flock, Parameters const& pars, unsigned int seed,
+                   int simulation = 0);
+// regular boids of the [snapshot]-th flock of the batch identified by seed,
+// after [steps] steps lasting duration/steps with no predators around: a flock
+// that has already formed, which many simulations can start from (each adding
+// its own predators). Plain boids are returned, so that starting a simulation
+// costs a copy of N_boids states
+std::vector<Boid> warm_start(Parameters const& pars, unsigned int seed,
+                             int snapshot, int steps);
+// returns the number of steps performed
+int simulate(Flock& flock, Parameters const& pars);
+// fills, adds predators and simulates the [simulation]-th flock of a batch
+Flock run_simulation(Parameters const& pars, unsigned int seed,
+                     int simulation);
 
 #endif
@@ -0,0 +1,212 @@
+#include "grid.hpp"
+
+// defines Grid's maintenance: full rebuild and incremental update
+
+// a boid leaves its cell by swapping with the last one of the cell, so that
+// both insertion and removal take constant time
+void Grid::insert(int i, int cell)
+{
+  cell_of_[i] = cell;
+  place_[i]   = static_cast<int>(cells_[cell].size());
+  cells_[cell].push_back(i);
+}
+
+void Grid::erase(int i)
+{
+  std::vector<int>& members{cells_[cell_of_[i]]};
+  int const last{members.back()};
+  members[place_[i]] = last;
+  place_[last]       = place_[i];
+  members.pop_back();
+  cell_of_[i] = -1;
+}
+
+void Grid::widen(Position const& p)
+{
+  x_lo_ = std::min(x_lo_, p.x());
+  y_lo_ = std::min(y_lo_, p.y());
+  x_hi_ = std::max(x_hi_, p.x());
+  y_hi_ = std::max(y_hi_, p.y());
+}
+
+// cells are widened by a relative margin, since the rounding of cell() may put
+// a boid on the edge of a cell in the next one. Border cells extend to the
+// boids out of the box
+std::array<double, 4> Grid::bounds(int x, int y) const
+{
+  double const margin{1e-9 * cell_};
+  double x0{x_min_ + x * cell_ - margin};
+  double y0{y_min_ + y * cell_ - margin};
+  double x1{x_min_ + (x + 1) * cell_ + margin};
+  double y1{y_min_ + (y + 1) * cell_ + margin};
+  if (x == 0) {
+    x0 = std::min(x0, x_lo_);
+  }
+  if (y == 0) {
+    y0 = std::min(y0, y_lo_);
+  }
+  if (x == cols_ - 1) {
+    x1 = std::max(x1, x_hi_);
+  }
+  if (y == rows_ - 1) {
+    y1 = std::max(y1, y_hi_);
+  }
+  return {x0, y0, x1, y1};
+}
+
+int Grid::cell(Position const& p) const
+{
+  int const col{std::clamp(static_cast<int>((p.x() - x_min_) / cell_), 0,
+                           cols_ - 1)};
+  int const row{std::clamp(static_cast<int>((p.y() - y_min_) / cell_), 0,
+                           rows_ - 1)};
+  return row * cols_ + col;
+}
+
+// sums are recomputed from scratch, since boids move within their cells too
+void Grid::aggregate(std::vector<Boid> const& boids)
+{
+  sums_.assign(cells_.size(), Sums{});
+  for (int k{0}; k != static_cast<int>(cells_.size()); ++k) {
+    for (int i : cells_[k]) {
+      sums_[k].position += boids[i].position();
+      sums_[k].velocity += boids[i].velocity();
+      ++sums_[k].count;
+    }
+  }
+}
+
+void Grid::rebuild(std::vector<Boid> const& boids, Parameters const& pars,
+                   double cell_size, bool aggregated, double margin)
+{
+  assert(cell_size > 0. && margin >= 0.);
+  x_min_ = pars.get_x_min() - margin;
+  y_min_ = pars.get_y_min() - margin;
+  cell_  = cell_size;
+  x_lo_  = x_min_;
+  y_lo_  = y_min_;
+  x_hi_  = pars.get_x_max() + margin;
+  y_hi_  = pars.get_y_max() + margin;
+  cols_  = std::max(static_cast<int>(std::ceil((x_hi_ - x_min_) / cell_)), 1);
+  rows_  = std::max(static_cast<int>(std::ceil((y_hi_ - y_min_) / cell_)), 1);
+  // cells keep their capacity across rebuilds
+  cells_.resize(cols_ * rows_);
+  for (auto& members : cells_) {
+    members.clear();
+  }
+  cell_of_.assign(boids.size(), -1);
+  place_.assign(boids.size(), 0);
+  for (int i{0}; i != static_cast<int>(boids.size()); ++i) {
+    if (!boids[i].is_pred() && !boids[i].is_eaten()) {
+      insert(i, cell(boids[i].position()));
+      widen(boids[i].position());
+    }
+  }
+  aggregated_ = aggregated;
+  if (aggregated_) {
+    aggregate(boids);
+  } else {
+    sums_.clear();
+  }
+  crossings_ = 0;
+  ++rebuilds_;
+}
+
+// new cells are found first, so that the grid is rebuilt (in time linear in
+// the number of boids, with no per-boid swaps) when too many boids crossed.
+// Otherwise only the boids that crossed are moved
+int Grid::update(std::vector<Boid> const& boids)
+{
+  assert(built() && boids.size() == cell_of_.size());
+  int const size{static_cast<int>(boids.size())};
+  next_.resize(size);
+  int crossed{0};
+  int indexed{0};
+  for (int i{0}; i != size; ++i) {
+    if (cell_of_[i] == -1) {
+      continue;
+    }
+    ++indexed;
+    if (boids[i].is_eaten()) {
+      next_[i] = -1;
+    } else {
+      next_[i] = cell(boids[i].position());
+      widen(boids[i].position());
+    }
+    if (next_[i] != cell_of_[i]) {
+      ++crossed;
+    }
+  }
+  crossings_ = crossed;
+  if (crossed > rebuild_fraction * indexed) {
+    for (auto& members : cells_) {
+      members.clear();
+    }
+    for (int i{0}; i != size; ++i) {
+      if (cell_of_[i] != -1) {
+        cell_of_[i] = -1;
+        if (next_[i] != -1) {
+          insert(i, next_[i]);
+        }
+      }
+    }
+    ++rebuilds_;
+  } else {
+    for (int i{0}; i != size && crossed != 0; ++i) {
+      if (cell_of_[i] != -1 && next_[i] != cell_of_[i]) {
+        erase(i);
+        if (next_[i] != -1) {
+          insert(i, next_[i]);
+        }
+        --crossed;
+      }
+    }
+  }
+  if (aggregated_) {
+    aggregate(boids);
+  }
+  return crossings_;
+}
+
+// sums only lose the boid, which keeps its last state
+void Grid::remove(std::vector<Boid> const& boids, int i)
+{
+  if (built() && cell_of_[i] != -1) {
+    if (aggregated_) {
+      Sums& sums{sums_[cell_of_[i]]};
+      sums.position -= boids[i].position();
+      sums.velocity -= boids[i].velocity();
+      --sums.count;
+    }
+    erase(i);
+  }
+}
+
+void Grid::add(std::vector<Boid> const& boids, int i)
+{
+  if (!built()) {
+    return;
+  }
+  assert(i == static_cast<int>(cell_of_.size()));
+  cell_of_.push_back(-1);
+  place_.push_back(0);
+  if (!boids[i].is_pred() && !boids[i].is_eaten()) {
+    insert(i, cell(boids[i].position()));
+    widen(boids[i].position());
+    if (aggregated_) {
+      Sums& sums{sums_[cell_of_[i]]};
+      sums.position += boids[i].position();
+      sums.velocity += boids[i].velocity();
+      ++sums.count;
+    }
+  }
+}
+
+void Grid::clear()
+{
+  sums_.clear();
+  aggregated_ = false;
+  cells_.clear();
+  cell_of_.clear();
+  place_.clear();
+}
@@ -0,0 +1,254 @@
+#ifndef GRID_HPP
+#define GRID_HPP
+
+#include "boids.hpp"
+#include "parameters.hpp"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+// defines Grid, a uniform grid of square cells indexing the alive regular boids
+// of a flock by position
+
+// the grid is kept in sync with the flock incrementally: after a step only the
+// boids that crossed into another cell are moved, and eaten boids are removed.
+// Boids are referred to by their index in the flock
+class Grid
+{
+ public:
+  // sums over the boids of a cell, for far-field approximations
+  struct Sums
+  {
+    Position position{0., 0.};
+    Velocity velocity{0., 0.};
+    int count{0};
+  };
+  // how much of a cell a query takes (see for_each_cover)
+  enum class Cover
+  {
+    none,
+    part,
+    whole
+  };
+
+ private:
+  double x_min_{0.};
+  double y_min_{0.};
+  double cell_{1.}; // side of the cells
+  int cols_{0};
+  int rows_{0};
+  // box of the simulation widened to the boids indexed out of it, which are
+  // assigned to border cells (not shrunk until the next rebuild)
+  double x_lo_{0.};
+  double y_lo_{0.};
+  double x_hi_{0.};
+  double y_hi_{0.};
+  // indices of the boids in each cell (row-major), in no particular order
+  std::vector<std::vector<int>> cells_;
+  // cell of each boid (-1 if not in the grid) and its place within the cell
+  std::vector<int> cell_of_;
+  std::vector<int> place_;
+  // scratch space of update: cell of each boid after the step
+  std::vector<int> next_;
+  // sums over each cell, kept only if the grid was rebuilt with aggregates
+  std::vector<Sums> sums_;
+  bool aggregated_{false};
+  int crossings_{0}; // boids moved by the last update
+  int rebuilds_{0};  // full rebuilds performed, including the first one
+
+  void insert(int i, int cell);
+  void erase(int i);
+  void widen(Position const& p);
+  void aggregate(std::vector<Boid> const& boids);
+  // bounds of the cell in column x and row y, holding any boid assigned to it
+  std::array<double, 4> bounds(int x, int y) const;
+
+ public:
+  // fraction of the indexed boids above which an update rebuilds the grid
+  // instead of moving boids one at a time
+  static constexpr double rebuild_fraction{.25};
+  // cells per neighbour distance when sums over cells are kept: smaller cells
+  // leave fewer boids to be checked one at a time on the rim of a neighbourhood
+  static constexpr int far_field_split{4};
+
+  bool built() const
+  {
+    return !cells_.empty();
+  }
+  double cell_size() const
+  {
+    return cell_;
+  }
+  int crossings() const
+  {
+    return crossings_;
+  }
+  int rebuilds() const
+  {
+    return rebuilds_;
+  }
+  bool aggregated() const
+  {
+    return aggregated_;
+  }
+  // cell containing p. Points out of the box (bound_position only steers boids
+  // back) are assigned to the closest border cell
+  int cell(Position const& p) const;
+  // indexes all alive regular boids, in cells of side cell_size covering the
+  // box of pars widened by margin on every side (ghost cells, holding the
+  // images of a periodic world). If aggregated, sums over the cells are kept in
+  // sync too
+  void rebuild(std::vector<Boid> const& boids, Parameters const& pars,
+               double cell_size, bool aggregated = false, double margin = 0.);
+  // brings the grid in sync with boids after a step. Returns the boids moved
+  int update(std::vector<Boid> const& boids);
+  // removes the i-th boid (e.g. since it was eaten)
+  void remove(std::vector<Boid> const& boids, int i);
+  // adds the i-th boid, if it is an alive regular one
+  void add(std::vector<Boid> const& boids, int i);
+  void clear();
+
+  // calls f(i) for every boid in a cell intersecting the square of side 2*r
+  // centred in p, skipping the cells whose bounds keep(x0, y0, x1, y1) is false
+  // for. It is up to f to check the actual distance
+  template<class F, class Keep>
+  void for_each_near(Position const& p, double r, F f, Keep keep) const
+  {
+    assert(built());
+    int const reach{static_cast<int>(std::ceil(r / cell_))};
+    int const c{cell(p)};
+    int const col{c % cols_};
+    int const row{c / cols_};
+    for (int y{std::max(row - reach, 0)}; y <= std::min(row + reach, rows_ - 1);
+         ++y) {
+      for (int x{std::max(col - reach, 0)};
+           x <= std::min(col + reach, cols_ - 1); ++x) {
+        auto const& members{cells_[y * cols_ + x]};
+        if (members.empty()) {
+          continue;
+        }
+        auto const b{bounds(x, y)};
+        if (!keep(b[0], b[1], b[2], b[3])) {
+          continue;
+        }
+        for (int i : members) {
+          f(i);
+        }
+      }
+    }
+  }
+  template<class F>
+  void for_each_near(Position const& p, double r, F f) const
+  {
+    for_each_near(p, r, f, [](double, double, double, double) { return true; });
+  }
+
+  // for every cell intersecting the square of side 2*r centred in p, as
+  // classified by cover(x0, y0, x1, y1) from its bounds: whole(sums) is called
+  // with the sums of the cells taken whole, f(i) for every boid of the ones
+  // taken in part. Requires an aggregated grid
+  template<class Classify, class Whole, class F>
+  void for_each_cover(Position const& p, double r, Classify cover, Whole whole,
+                      F f) const
+  {
+    assert(built() && aggregated_);
+    int const reach{static_cast<int>(std::ceil(r / cell_))};
+    int const c{cell(p)};
+    int const col{c % cols_};
+    int const row{c / cols_};
+    for (int y{std::max(row - reach, 0)}; y <= std::min(row + reach, rows_ - 1);
+         ++y) {
+      for (int x{std::max(col - reach, 0)};
+           x <= std::min(col + reach, cols_ - 1); ++x) {
+        int const k{y * cols_ + x};
+        if (cells_[k].empty()) {
+          continue;
+        }
+        auto const b{bounds(x, y)};
+        switch (cover(b[0], b[1], b[2], b[3])) {
+        case Cover::none:
+          break;
+        case Cover::whole:
+          whole(sums_[k]);
+          break;
+        case Cover::part:
+          for (int i : cells_[k]) {
+            f(i);
+          }
+          break;
+        }
+      }
+    }
+  }
+
+  // index of the boid closest to p among the ones accept(i) is true for (the
+  // lowest index among equally close ones), -1 if none is. Cells are searched
+  // ring by ring outwards from p's: the cells of ring k are at least k - 1
+  // cells away from p, so the search ends as soon as that exceeds the distance
+  // of the best boid found. accept is only called for boids closer than it.
+  // Cells whose bounds keep(x0, y0, x1, y1) is false for are skipped
+  template<class Accept, class Keep>
+  int nearest(std::vector<Boid> const& boids, Position const& p,
+              Accept accept, Keep keep) const
+  {
+    assert(built());
+    int const c{cell(p)};
+    int const col{c % cols_};
+    int const row{c / cols_};
+    int const rings{std::max({col, cols_ - 1 - col, row, rows_ - 1 - row})};
+    int best{-1};
+    double best_d2{std::numeric_limits<double>::infinity()};
+    auto const visit{[&](int x, int y) {
+      auto const& members{cells_[y * cols_ + x]};
+      if (members.empty()) {
+        return;
+      }
+      auto const b{bounds(x, y)};
+      if (!keep(b[0], b[1], b[2], b[3])) {
+        return;
+      }
+      for (int i : members) {
+        double const d2{squared_distance(p, boids[i].position())};
+        if ((d2 < best_d2 || (d2 == best_d2 && i < best)) && accept(i)) {
+          best    = i;
+          best_d2 = d2;
+        }
+      }
+    }};
+    for (int k{0}; k <= rings; ++k) {
+      // slightly shrunk, to absorb the rounding of cell assignment
+      double const bound{(k - 1) * cell_ * (1. - 1e-9)};
+      if (k > 1 && bound * bound > best_d2) {
+        break;
+      }
+      for (int y{std::max(row - k, 0)}; y <= std::min(row + k, rows_ - 1);
+           ++y) {
+        if (y == row - k || y == row + k) { // top and bottom sides
+          for (int x{std::max(col - k, 0)};
+               x <= std::min(col + k, cols_ - 1); ++x) {
+            visit(x, y);
+          }
+        } else { // left and right sides
+          if (col - k >= 0) {
+            visit(col - k, y);
+          }
+          if (k != 0 && col + k < cols_) {
+            visit(col + k, y);
+          }
+        }
+      }
+    }
+    return best;
+  }
+  template<class Accept>
+  int nearest(std::vector<Boid> const& boids, Position const& p,
+              Accept accept) const
+  {
+    return nearest(boids, p, accept,
+                   [](double, double, double, double) { return true; });
+  }
+};
+
+#endif
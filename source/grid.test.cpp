@@ -0,0 +1,213 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "grid.hpp"
+#include "doctest.h"
+
+namespace {
+// boids found by for_each_near, sorted
+std::vector<int> near(Grid const& grid, Position const& p, double r)
+{
+  std::vector<int> found;
+  grid.for_each_near(p, r, [&](int i) { found.push_back(i); });
+  std::sort(found.begin(), found.end());
+  return found;
+}
+
+// boids found by for_each_near in the cells viewer may see, sorted
+std::vector<int> near_seen(Grid const& grid, Boid const& viewer, double angle,
+                           double r)
+{
+  View_cone const cone{viewer, angle};
+  std::vector<int> found;
+  grid.for_each_near(
+      viewer.position(), r, [&](int i) { found.push_back(i); },
+      [&](double x0, double y0, double x1, double y1) {
+        return cone.may_see(x0, y0, x1, y1);
+      });
+  std::sort(found.begin(), found.end());
+  return found;
+}
+
+// sums over all the cells of an aggregated grid, and over the indexed boids
+std::pair<Grid::Sums, Grid::Sums> totals(Grid const& grid,
+                                         std::vector<Boid> const& boids)
+{
+  Grid::Sums cells{};
+  grid.for_each_cover(
+      {50., 50.}, 100.,
+      [](double, double, double, double) { return Grid::Cover::whole; },
+      [&](Grid::Sums const& sums) {
+        cells.position += sums.position;
+        cells.velocity += sums.velocity;
+        cells.count += sums.count;
+      },
+      [](int) {});
+  Grid::Sums indexed{};
+  for (int i : near(grid, {50., 50.}, 100.)) {
+    indexed.position += boids[i].position();
+    indexed.velocity += boids[i].velocity();
+    ++indexed.count;
+  }
+  return {cells, indexed};
+}
+} // namespace
+
+TEST_CASE("testing grid")
+{
+  // box is 100 x 100: cells of side 10 make a 10 x 10 grid
+  Parameters const pars{90.,     5.,  2., 1., 1., 1., 100,
+                        .000005, 10., 10, 2,  10, 40};
+  std::vector<Boid> boids{Boid{{5., 5.}, {1., 0.}},
+                          Boid{{15., 5.}, {1., 0.}},
+                          Boid{{6., 6.}, {1., 0.}, true},
+                          Boid{{95., 95.}, {1., 0.}},
+                          Boid{{55., 55.}, {1., 0.}},
+                          Boid{{75., 15.}, {1., 0.}},
+                          Boid{{75., 25.}, {1., 0.}},
+                          Boid{{85., 15.}, {1., 0.}},
+                          Boid{{85., 25.}, {1., 0.}}};
+  boids[4].is_eaten() = true;
+  Grid grid;
+  CHECK_FALSE(grid.built());
+  grid.rebuild(boids, pars, 10.);
+  CHECK(grid.rebuilds() == 1);
+
+  SUBCASE("testing cell")
+  {
+    CHECK(grid.cell({5., 5.}) == 0);
+    CHECK(grid.cell({15., 5.}) == 1);
+    CHECK(grid.cell({5., 15.}) == 10);
+    CHECK(grid.cell({95., 95.}) == 99);
+    // out of the box: closest border cell
+    CHECK(grid.cell({-3., 105.}) == 90);
+  }
+
+  SUBCASE("only alive regular boids are indexed")
+  {
+    CHECK(near(grid, {50., 50.}, 100.)
+          == std::vector<int>{0, 1, 3, 5, 6, 7, 8});
+    CHECK(near(grid, {5., 5.}, 1.) == std::vector<int>{0, 1});
+    CHECK(near(grid, {95., 95.}, 1.) == std::vector<int>{3});
+  }
+
+  SUBCASE("update moves only the boids that crossed")
+  {
+    boids[0].position() = {7., 7.};   // same cell
+    boids[1].position() = {25., 5.};  // next cell
+    boids[3].position() = {94., 94.}; // same cell
+    CHECK(grid.update(boids) == 1);
+    CHECK(grid.rebuilds() == 1);
+    CHECK(near(grid, {25., 5.}, 1.) == std::vector<int>{1});
+    CHECK(near(grid, {5., 5.}, 1.) == std::vector<int>{0});
+  }
+
+  SUBCASE("eaten boids are removed")
+  {
+    grid.remove(boids, 0);
+    CHECK(near(grid, {5., 5.}, 1.) == std::vector<int>{1});
+    boids[1].is_eaten() = true;
+    CHECK(grid.update(boids) == 1);
+    CHECK(near(grid, {50., 50.}, 100.) == std::vector<int>{3, 5, 6, 7, 8});
+  }
+
+  SUBCASE("many crossings rebuild the grid")
+  {
+    for (auto& b : boids) {
+      b.position() += Position{20., 0.};
+    }
+    boids[3].position() = {15., 95.};
+    CHECK(grid.update(boids) == 7);
+    CHECK(grid.rebuilds() == 2);
+    CHECK(near(grid, {25., 5.}, 1.) == std::vector<int>{0, 1});
+    CHECK(near(grid, {15., 95.}, 1.) == std::vector<int>{3});
+    CHECK(near(grid, {95., 20.}, 1.) == std::vector<int>{5, 6, 7, 8});
+  }
+
+  SUBCASE("nearest searches rings outwards")
+  {
+    auto const any{[](int) { return true; }};
+    CHECK(grid.nearest(boids, {8., 8.}, any) == 0);
+    CHECK(grid.nearest(boids, {14., 6.}, any) == 1);
+    CHECK(grid.nearest(boids, {90., 90.}, any) == 3);
+    CHECK(grid.nearest(boids, {80., 20.}, any) == 5); // ties: lowest index
+    CHECK(grid.nearest(boids, {8., 8.}, [](int i) { return i > 1; }) == 5);
+    CHECK(grid.nearest(boids, {8., 8.}, [](int) { return false; }) == -1);
+  }
+
+  SUBCASE("cells out of the field of view are skipped")
+  {
+    // the cells of boids 5 and 6 are behind the viewer
+    Boid const viewer{{81., 20.}, {1., 0.}};
+    CHECK(near(grid, viewer.position(), 10.)
+          == std::vector<int>{5, 6, 7, 8});
+    CHECK(near_seen(grid, viewer, 100., 10.) == std::vector<int>{7, 8});
+    // the selections and nearest boids are unchanged
+    for (double x{2.}; x < 100.; x += 6.) {
+      for (double y{2.}; y < 100.; y += 6.) {
+        for (Velocity v : {Velocity{1., 0.}, Velocity{-1., 1.}}) {
+          Boid const b{{x, y}, v};
+          auto const seen{[&](int i) { return is_seen(b, boids[i], 90.); }};
+          std::vector<int> all{near(grid, b.position(), 20.)};
+          all.erase(std::remove_if(all.begin(), all.end(),
+                                   [&](int i) { return !seen(i); }),
+                    all.end());
+          std::vector<int> culled{near_seen(grid, b, 90., 20.)};
+          culled.erase(std::remove_if(culled.begin(), culled.end(),
+                                      [&](int i) { return !seen(i); }),
+                       culled.end());
+          CHECK(culled == all);
+          View_cone const cone{b, 90.};
+          CHECK(grid.nearest(boids, b.position(), seen,
+                             [&](double x0, double y0, double x1, double y1) {
+                               return cone.may_see(x0, y0, x1, y1);
+                             })
+                == grid.nearest(boids, b.position(), seen));
+        }
+      }
+    }
+  }
+
+  SUBCASE("sums over cells are kept in sync")
+  {
+    CHECK_FALSE(grid.aggregated());
+    grid.rebuild(boids, pars, 10., true);
+    CHECK(grid.aggregated());
+    auto const check{[&](int count) {
+      auto const [cells, indexed] = totals(grid, boids);
+      CHECK(cells.count == count);
+      CHECK(indexed.count == count);
+      CHECK(cells.position.x() == doctest::Approx(indexed.position.x()));
+      CHECK(cells.position.y() == doctest::Approx(indexed.position.y()));
+      CHECK(cells.velocity.x() == doctest::Approx(indexed.velocity.x()));
+      CHECK(cells.velocity.y() == doctest::Approx(indexed.velocity.y()));
+    }};
+    check(7);
+    boids[0].position() = {7., 7.};
+    boids[1].position() = {25., 5.};
+    boids[1].velocity() = {0., 2.};
+    grid.update(boids);
+    check(7);
+    grid.remove(boids, 1);
+    check(6);
+    boids.push_back(Boid{{45., 45.}, {1., 1.}});
+    grid.add(boids, 9);
+    check(7);
+    // parts of cells are visited a boid at a time
+    std::vector<int> part;
+    grid.for_each_cover(
+        {5., 5.}, 1.,
+        [](double, double, double, double) { return Grid::Cover::part; },
+        [](Grid::Sums const&) { CHECK(false); },
+        [&](int i) { part.push_back(i); });
+    CHECK(part == std::vector<int>{0});
+  }
+
+  SUBCASE("added boids are indexed")
+  {
+    boids.push_back(Boid{{45., 45.}, {1., 0.}});
+    grid.add(boids, 9);
+    boids.push_back(Boid{{45., 45.}, {1., 0.}, true});
+    grid.add(boids, 10);
+    CHECK(near(grid, {45., 45.}, 1.) == std::vector<int>{9});
+    CHECK(grid.update(boids) == 0);
+  }
+}
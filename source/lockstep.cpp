@@ -0,0 +1,232 @@
+#include "lockstep.hpp"
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+// defines Lockstep's constructor, its step and the rules of its lanes
+
+namespace {
+bool has_preys(Flock const& flock)
+{
+  return std::any_of(
+      flock.state().begin(), flock.state().end(),
+      [](Boid const& b) { return !b.is_pred() && !b.is_eaten(); });
+}
+} // namespace
+
+Lockstep::Lockstep(std::vector<Flock> flocks, Parameters const& pars)
+    : flocks_(std::move(flocks))
+    , pars_{pars}
+{
+  is_in_range(size(), 0, max_lanes + 1, "lanes");
+  if (std::any_of(flocks_.begin(), flocks_.end(), [&](Flock const& flock) {
+        return flock.size() != flocks_[0].size();
+      })) {
+    throw Invalid_Parameter{"Flocks stepped in lock-step must have the same "
+                            "number of boids"};
+  }
+  if (pars.get_adaptive_steps() || pars.get_periodic()
+      || pars.get_far_field()) {
+    throw Invalid_Parameter{"Flocks stepped in lock-step support neither "
+                            "adaptive steps, periodic worlds nor far-field "
+                            "sums"};
+  }
+  for (Flock const& flock : flocks_) {
+    finished_.push_back(!has_preys(flock));
+  }
+  logs_.assign(flocks_.size(), nullptr);
+}
+
+void Lockstep::attach(int lane, Capture_log* log)
+{
+  logs_[lane] = log;
+  flocks_[lane].attach(log);
+}
+
+void Lockstep::load()
+{
+  int const lanes{static_cast<int>(lanes_.size())};
+  width_ = (lanes <= 4) ? 4 : (lanes <= 8) ? 8 : max_lanes;
+  int const n{flocks_[lanes_[0]].size()};
+  int const slots{n * width_};
+  // empty lanes hold boids that are neither regular nor predators
+  x_.assign(slots, 0.);
+  y_.assign(slots, 0.);
+  v_x_.assign(slots, 1.);
+  v_y_.assign(slots, 0.);
+  squared_speed_.assign(slots, 1.);
+  regular_.assign(slots, 0.);
+  predator_.assign(slots, 0.);
+  d_v_x_.assign(slots, 0.);
+  d_v_y_.assign(slots, 0.);
+  for (int k{0}; k != lanes; ++k) {
+    auto const& boids{flocks_[lanes_[k]].state()};
+    for (int i{0}; i != n; ++i) {
+      Boid const& b{boids[i]};
+      int const slot{i * width_ + k};
+      x_[slot]             = b.position().x();
+      y_[slot]             = b.position().y();
+      v_x_[slot]           = b.velocity().x();
+      v_y_[slot]           = b.velocity().y();
+      squared_speed_[slot] = b.velocity().x() * b.velocity().x()
+                           + b.velocity().y() * b.velocity().y();
+      regular_[slot]       = (!b.is_pred() && !b.is_eaten()) ? 1. : 0.;
+      predator_[slot]      = b.is_pred() ? 1. : 0.;
+    }
+  }
+}
+
+// separation, alignment and cohesion of the i-th boids of all the lanes, as in
+// flock.cpp. A boid sees another if their positions coincide or the cosine of
+// the angle between its velocity v and their difference of positions p is at
+// least cos_view, i.e. (with s = v . p) if s >= 0 and s^2 >= cos_view^2 v^2 p^2
+// for a forward cone (cos_view >= 0), or if s >= 0 or s^2 <= cos_view^2 v^2 p^2
+// otherwise: no square root is taken
+template<int width, bool forward>
+void Lockstep::regular_rules()
+{
+  int const n{static_cast<int>(x_.size()) / width};
+  double const cos_view{std::cos(pi * pars_.get_angle() / 360.)};
+  double const squared_cos{cos_view * cos_view};
+  double const d2{pars_.get_d() * pars_.get_d()};
+  double const d_s2{pars_.get_d_s() * pars_.get_d_s()};
+  double const d_s_pred2{pars_.get_d_s_pred() * pars_.get_d_s_pred()};
+  std::array<double, width> sep_x;
+  std::array<double, width> sep_y;
+  std::array<double, width> pred_x;
+  std::array<double, width> pred_y;
+  std::array<double, width> count;
+  std::array<double, width> coh_x;
+  std::array<double, width> coh_y;
+  std::array<double, width> ali_x;
+  std::array<double, width> ali_y;
+  for (int i{0}; i != n; ++i) {
+    double const* const regular_i{&regular_[i * width]};
+    if (std::none_of(regular_i, regular_i + width,
+                     [](double r) { return r != 0.; })) {
+      continue; // a predator, or eaten in every lane
+    }
+    double const* const x_i{&x_[i * width]};
+    double const* const y_i{&y_[i * width]};
+    double const* const v_x_i{&v_x_[i * width]};
+    double const* const v_y_i{&v_y_[i * width]};
+    double const* const speed2_i{&squared_speed_[i * width]};
+    sep_x.fill(0.);
+    sep_y.fill(0.);
+    pred_x.fill(0.);
+    pred_y.fill(0.);
+    count.fill(0.);
+    coh_x.fill(0.);
+    coh_y.fill(0.);
+    ali_x.fill(0.);
+    ali_y.fill(0.);
+    for (int j{0}; j != n; ++j) {
+      double const* const x_j{&x_[j * width]};
+      double const* const y_j{&y_[j * width]};
+      double const* const v_x_j{&v_x_[j * width]};
+      double const* const v_y_j{&v_y_[j * width]};
+      double const* const regular_j{&regular_[j * width]};
+      double const* const predator_j{&predator_[j * width]};
+      for (int k{0}; k != width; ++k) {
+        double const xdiff{x_j[k] - x_i[k]};
+        double const ydiff{y_j[k] - y_i[k]};
+        double const squared{xdiff * xdiff + ydiff * ydiff};
+        double const prod{xdiff * v_x_i[k] + ydiff * v_y_i[k]};
+        double const bound{squared_cos * speed2_i[k] * squared};
+        // masks of 1s and 0s, multiplied rather than tested
+        double const ahead{static_cast<double>(prod >= 0.)};
+        double const squared_prod{prod * prod};
+        double const within{
+            static_cast<double>(forward ? squared_prod >= bound
+                                        : squared_prod <= bound)};
+        double const cone{forward ? ahead * within
+                                  : ahead + within - ahead * within};
+        double const coincide{static_cast<double>(squared == 0.)};
+        double const seen{coincide + cone - coincide * cone};
+        double const in_d{seen * static_cast<double>(squared < d2)
+                          * regular_j[k]};
+        double const in_d_s{seen * static_cast<double>(squared < d_s2)
+                            * regular_j[k]};
+        double const in_d_s_pred{seen * static_cast<double>(squared < d_s_pred2)
+                                 * predator_j[k]};
+        sep_x[k] += in_d_s * xdiff;
+        sep_y[k] += in_d_s * ydiff;
+        pred_x[k] += in_d_s_pred * xdiff;
+        pred_y[k] += in_d_s_pred * ydiff;
+        count[k] += in_d;
+        coh_x[k] += in_d * xdiff;
+        coh_y[k] += in_d * ydiff;
+        ali_x[k] += in_d * (v_x_j[k] - v_x_i[k]);
+        ali_y[k] += in_d * (v_y_j[k] - v_y_i[k]);
+      }
+    }
+    // neighbours include the boid itself
+    for (int k{0}; k != width; ++k) {
+      double const others{count[k] - 1.};
+      double const a{(others > 0.) ? pars_.get_a() / others : 0.};
+      double const c{(others > 0.) ? pars_.get_c() / others : 0.};
+      d_v_x_[i * width + k] = sep_x[k] * -pars_.get_s()
+                            + pred_x[k] * -pars_.get_s_pred()
+                            + ali_x[k] * a + coh_x[k] * c;
+      d_v_y_[i * width + k] = sep_y[k] * -pars_.get_s()
+                            + pred_y[k] * -pars_.get_s_pred()
+                            + ali_y[k] * a + coh_y[k] * c;
+    }
+  }
+}
+
+void Lockstep::evolve()
+{
+  lanes_.clear();
+  for (int k{0}; k != size(); ++k) {
+    if (!finished_[k]) {
+      lanes_.push_back(k);
+    } else if (logs_[k] != nullptr) {
+      logs_[k]->end_step(flocks_[k].counter());
+    }
+  }
+  if (lanes_.empty()) {
+    return;
+  }
+  load();
+  // the test of sight differs for cones wider than a half-plane
+  bool const forward{pars_.get_angle() <= 180.};
+  if (width_ == 4) {
+    forward ? regular_rules<4, true>() : regular_rules<4, false>();
+  } else if (width_ == 8) {
+    forward ? regular_rules<8, true>() : regular_rules<8, false>();
+  } else {
+    forward ? regular_rules<max_lanes, true>()
+            : regular_rules<max_lanes, false>();
+  }
+  double const d_t{pars_.get_duration() / pars_.get_steps()};
+  for (int k{0}; k != static_cast<int>(lanes_.size()); ++k) {
+    Flock& flock{flocks_[lanes_[k]]};
+    next_.clear();
+    for (int i{0}; i != flock.size(); ++i) {
+      Boid const& boid{flock.state()[i]};
+      if (boid.is_eaten()) {
+        next_.push_back(boid);
+      } else if (boid.is_pred()) {
+        next_.push_back(update(boid,
+                               separation(boid, flock, pars_)
+                                   + seek(boid, flock, pars_),
+                               pars_, d_t));
+      } else {
+        int const slot{i * width_ + k};
+        next_.push_back(
+            update(boid, {d_v_x_[slot], d_v_y_[slot]}, pars_, d_t));
+      }
+    }
+    flock.evolve(pars_, next_);
+    finished_[lanes_[k]] = !has_preys(flock);
+  }
+}
+
+int Lockstep::simulate()
+{
+  for (int step{0}; step != pars_.get_steps(); ++step) {
+    evolve();
+  }
+  return pars_.get_steps();
+}
@@ -0,0 +1,73 @@
+#ifndef LOCKSTEP_HPP
+#define LOCKSTEP_HPP
+
+#include "flock.hpp"
+
+// defines Lockstep, independent flocks evolved together a step at a time
+
+// flocks sharing their parameters and their number of boids (e.g. the
+// simulations of a Monte Carlo batch) are stepped in lock-step, each in a lane
+// of arrays holding boid i of every flock in a row of [width] doubles (4, 8 or
+// 16, the fewest that hold the running flocks). The rules of the regular boids
+// are computed for all the lanes at once, in loops over rows the compiler can
+// vectorize: instead of selecting neighbours, every boid of a row is weighed
+// by masks (alive, regular, predator, in sight and within each distance of the
+// rules) that zero the ones the rules skip. Predators, few per flock, follow
+// the rules of Flock, and new states, captures and logs are made as by
+// evolve. The rules of the regular boids are summed in another order and
+// compare squared distances, so states match the ones of evolve up to rounding
+// only: flocks evolve as statistically the same ones, not bit for bit. A
+// flock with no alive preys left is finished: its counter can no longer
+// change, so it is not stepped anymore and drops out of the lanes
+class Lockstep
+{
+  std::vector<Flock> flocks_;
+  Parameters pars_;
+  std::vector<char> finished_;
+  // logs attached through attach, which finished flocks keep ending steps of
+  std::vector<Capture_log*> logs_;
+  // flocks in the lanes, and the arrays of their boids, with the velocity
+  // changes the rules give the regular ones. Regular (alive) and predator are
+  // masks of 1s and 0s
+  std::vector<int> lanes_;
+  int width_{0};
+  std::vector<double> x_;
+  std::vector<double> y_;
+  std::vector<double> v_x_;
+  std::vector<double> v_y_;
+  std::vector<double> squared_speed_;
+  std::vector<double> regular_;
+  std::vector<double> predator_;
+  std::vector<double> d_v_x_;
+  std::vector<double> d_v_y_;
+  std::vector<Boid> next_; // scratch space of evolve
+  void load();
+  template<int width, bool forward>
+  void regular_rules();
+
+ public:
+  // throws Invalid_Parameter for no flocks or more than max_lanes, for flocks
+  // of different sizes, and for adaptive steps, periodic worlds and far-field
+  // sums. The engine of pars is ignored: every boid is checked
+  Lockstep(std::vector<Flock> flocks, Parameters const& pars);
+  static constexpr int max_lanes{16};
+  int size() const
+  {
+    return static_cast<int>(flocks_.size());
+  }
+  std::vector<Flock> const& flocks() const
+  {
+    return flocks_;
+  }
+  bool finished(int lane) const
+  {
+    return finished_[lane];
+  }
+  void attach(int lane, Capture_log* log);
+  // evolves every flock that is not finished by a step lasting duration/steps
+  void evolve();
+  // returns the number of steps performed
+  int simulate();
+};
+
+#endif
@@ -0,0 +1,113 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "lockstep.hpp"
+#include "doctest.h"
+
+namespace {
+// the first [n] flocks of the batch identified by seed
+std::vector<Flock> batch(Parameters const& pars, unsigned int seed, int n)
+{
+  std::vector<Flock> flocks;
+  for (int i{0}; i != n; ++i) {
+    std::vector<Boid> boids{};
+    Flock flock{fill(boids, pars, seed, i)};
+    add_predators(flock, pars, seed, i);
+    flocks.push_back(flock);
+  }
+  return flocks;
+}
+} // namespace
+
+TEST_CASE("Testing lock-step flocks")
+{
+  SUBCASE("a step matches evolve up to rounding")
+  {
+    for (int seek_type : {0, 1, 2}) {
+      for (double angle : {300., 90.}) {
+        Parameters pars{angle, 35., 3.5, .7,  .045, .8, 80., .05,
+                        30.,   300, 40,  300, 60,   2,  seek_type};
+        for (int lanes : {1, 7, Lockstep::max_lanes}) {
+          // flocks that have clustered and lost some preys
+          std::vector<Flock> flocks{batch(pars, 97u, lanes)};
+          for (Flock& flock : flocks) {
+            for (int step{0}; step != 100; ++step) {
+              flock.evolve(pars);
+            }
+          }
+          Lockstep lockstep{flocks, pars};
+          lockstep.evolve();
+          for (int k{0}; k != lanes; ++k) {
+            Flock alone{flocks[k]};
+            alone.evolve(pars);
+            Flock const& flock{lockstep.flocks()[k]};
+            CHECK(flock.step() == alone.step());
+            CHECK(flock.counter() == alone.counter());
+            CHECK(flock.captures() == alone.captures());
+            for (int i{0}; i != flock.size(); ++i) {
+              Boid const& b{flock.state()[i]};
+              Boid const& expected{alone.state()[i]};
+              CHECK(b.position().x()
+                    == doctest::Approx(expected.position().x()).epsilon(1e-9));
+              CHECK(b.position().y()
+                    == doctest::Approx(expected.position().y()).epsilon(1e-9));
+              CHECK(b.velocity().x()
+                    == doctest::Approx(expected.velocity().x()).epsilon(1e-9));
+              CHECK(b.velocity().y()
+                    == doctest::Approx(expected.velocity().y()).epsilon(1e-9));
+              CHECK(b.is_eaten() == expected.is_eaten());
+            }
+          }
+        }
+      }
+    }
+  }
+
+  SUBCASE("finished flocks are no longer stepped")
+  {
+    Parameters pars{300., 35., 3.5, .7, .045, .8, 80., .05,
+                    30.,  300, 40,  300, 2,   1,  0};
+    // the only prey of the first flock is within reach of its predator
+    std::vector<Flock> flocks{
+        Flock{{Boid{{50., 50.}, {10., 0.}}, Boid{{51., 50.}, {10., 0.}},
+               Boid{{49.9, 50.}, {10., 0.}, true}}},
+        Flock{{Boid{{20., 50.}, {10., 0.}}, Boid{{21., 50.}, {10., 0.}},
+               Boid{{80., 50.}, {-10., 0.}, true}}}};
+    flocks[0].state()[1].is_eaten() = true;
+    Lockstep lockstep{flocks, pars};
+    Capture_log log{10, 5};
+    lockstep.attach(0, &log);
+    CHECK_FALSE(lockstep.finished(0));
+    lockstep.evolve();
+    CHECK(lockstep.finished(0));
+    CHECK(lockstep.flocks()[0].counter() == 1);
+    auto const frozen{lockstep.flocks()[0].state()[2].position()};
+    for (int step{0}; step != 4; ++step) {
+      lockstep.evolve();
+    }
+    CHECK(lockstep.flocks()[0].state()[2].position() == frozen);
+    CHECK(lockstep.flocks()[0].step() == 1);
+    CHECK(lockstep.flocks()[1].step() == 5);
+    // the log of a finished flock still gets a count for every step
+    CHECK(log.series() == std::vector<int>{1, 1, 1, 1, 1});
+  }
+
+  SUBCASE("unsupported flocks and settings")
+  {
+    Parameters pars{300., 35., 3.5, .7,  .045, .8, 80., .05,
+                    30.,  300, 40,  300, 60,   2,  0};
+    CHECK_THROWS_AS(Lockstep(std::vector<Flock>{}, pars), Invalid_Parameter);
+    CHECK_THROWS_AS(Lockstep(batch(pars, 1u, Lockstep::max_lanes + 1), pars),
+                    Invalid_Parameter);
+    std::vector<Flock> flocks{batch(pars, 1u, 2)};
+    flocks[1].push_back(Boid{{1., 1.}, {1., 0.}});
+    CHECK_THROWS_AS(Lockstep(flocks, pars), Invalid_Parameter);
+    Parameters adaptive{pars};
+    adaptive.set_adaptive_steps() = true;
+    CHECK_THROWS_AS(Lockstep(batch(pars, 1u, 2), adaptive), Invalid_Parameter);
+    Parameters periodic{pars};
+    periodic.set_periodic() = true;
+    CHECK_THROWS_AS(Lockstep(batch(pars, 1u, 2), periodic), Invalid_Parameter);
+    Parameters far_field{pars};
+    far_field.set_far_field() = true;
+    CHECK_THROWS_AS(Lockstep(batch(pars, 1u, 2), far_field), Invalid_Parameter);
+  }
+}
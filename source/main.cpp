@@ -1,10 +1,18 @@
 #include "boids.hpp"
+#include "cache.hpp"
+#include "domains.hpp"
 #include "flock.hpp"
+#include "lockstep.hpp"
+#include "optimise.hpp"
+#include "parallel.hpp"
 #include "parameters.hpp"
 #include "parser.hpp"
 #include "stats.hpp"
 
+#include <algorithm>
 #include <fstream>
+#include <numeric>
+#include <optional>
 #include <random>
 
 int main(int argc, char* argv[])
@@ -26,11 +34,49 @@ int main(int argc, char* argv[])
     int N_preds{1};
     auto show_help{false};
     int seek_type{0};
+    // a single seed identifies the whole batch: the initial conditions of the
+    // i-th simulation only depend on (seed, i)
+    unsigned int seed{std::random_device{}()};
+    int log_capacity{0};
+    auto log_series{false};
+    auto swept{false};
+    int integrator{0};
+    auto adaptive{false};
+    int reorder{0};
+    int engine{0};
+    // negative if cohesion and alignment are exact
+    double far_field{-1.};
+    auto periodic{false};
+    // 0 if simulations run in this process only
+    int workers{0};
+    // 0 if simulations run one at a time
+    int lanes{0};
+    // steps of the prey-only formation phase (0 for a cold start), and number
+    // of formed flocks the simulations share
+    int formation{0};
+    int snapshots{1};
+    // if true, every seek type is run on the same simulations
+    auto paired{false};
+    // if > 0, simulations are added until the confidence interval is narrower
+    // (up to max_sims simulations)
+    double ci_width{0.};
+    int max_sims{1000};
+    // directory of the result cache (none if empty)
+    std::string cache_dir{};
+    // if > 0, the flying rules are optimised within this number of
+    // evaluations, each of opt_sims simulations
+    int optimise{0};
+    int opt_sims{20};
 
     // Parser with multiple option arguments and help option
     auto parser = get_parser(angle, d, d_s, s, c, a, max_speed,
                              min_speed_fraction, duration, steps, prescale,
-                             N_boids, N_preds, show_help, seek_type);
+                             N_boids, N_preds, show_help, seek_type, seed,
+                             log_capacity, log_series, swept, integrator,
+                             adaptive, reorder, engine, far_field, periodic,
+                             workers, lanes, formation, snapshots, paired,
+                             ci_width, max_sims, cache_dir, optimise,
+                             opt_sims);
 
     // Parses the arguments
     auto result = parser.parse({argc, argv});
@@ -52,34 +98,332 @@ int main(int argc, char* argv[])
 
     int const prescale_limit{steps};
 
-    Parameters const pars{angle,    d,       d_s,       s,
-                          c,        a,       max_speed, min_speed_fraction,
-                          duration, steps,   prescale,  prescale_limit,
-                          N_boids,  N_preds, seek_type};
+    Parameters pars{angle,    d,       d_s,       s,
+                    c,        a,       max_speed, min_speed_fraction,
+                    duration, steps,   prescale,  prescale_limit,
+                    N_boids,  N_preds, seek_type};
+    pars.set_swept_capture() = swept;
+    is_in_range(integrator, -1, 3, "integrator");
+    pars.set_integrator() = static_cast<Integrator>(integrator);
+    pars.set_adaptive_steps() = adaptive;
+    is_in_range(reorder, -1, steps + 1, "reorder-interval");
+    pars.set_reorder_interval() = reorder;
+    is_in_range(engine, -1, 5, "engine");
+    pars.set_engine() = static_cast<Engine>(engine);
+    if (far_field >= 0.) {
+      is_in_range(far_field, -1., 1., "far-field tolerance");
+      pars.set_far_field()           = true;
+      pars.set_far_field_tolerance() = far_field;
+    }
+    pars.set_periodic() = periodic;
+    if (periodic) {
+      // no boid may see both another boid and its image across the borders
+      is_in_range(2. * ghost_reach(pars), 0.,
+                  std::min(pars.get_x_max() - pars.get_x_min(),
+                           pars.get_y_max() - pars.get_y_min()),
+                  "distance of the rules in a periodic world");
+    }
+
+    is_greater_than(log_capacity, -1, "log-captures");
+    if (log_series && log_capacity == 0) {
+      throw Invalid_Parameter{"Series are logged with the captures: "
+                              "--log-series requires --log-captures"};
+    }
+
+    // confidence level of the intervals reported
+    double const ci_level{.95};
+
+    is_in_range(workers, -1, N_boids + N_preds + 1, "workers");
+    is_in_range(lanes, -1, Lockstep::max_lanes + 1, "lanes");
+    if (lanes > 0 && workers > 0) {
+      throw Invalid_Parameter{"Lanes and workers cannot be combined"};
+    }
+    // the workers' simulations are not logged
+    if (workers > 0 && log_capacity > 0) {
+      throw Invalid_Parameter{"Captures cannot be logged with workers"};
+    }
+    if (ci_width != 0.) {
+      is_greater_than(ci_width, 0., "ci-width");
+    }
+
+    if (optimise > 0) {
+      if (paired || ci_width > 0. || lanes > 0 || workers > 0 || formation > 0
+          || log_capacity > 0 || periodic) {
+        throw Invalid_Parameter{
+            "The optimiser runs plain batches: it cannot be combined with "
+            "paired mode, target widths, lanes, workers, warm starts, capture "
+            "logs or a periodic world"};
+      }
+      std::optional<Result_cache> opt_cache{};
+      if (!cache_dir.empty()) {
+        opt_cache.emplace(cache_dir);
+      }
+      Result_cache* const store{opt_cache ? &*opt_cache : nullptr};
+      Optimum const optimum{
+          optimise_rules(pars, seed, opt_sims, optimise, store)};
+      // the simulations searched favour the optimum (it was picked on them):
+      // fresh ones, paired between start and optimum, tell its actual gain
+      std::vector<double> const searched{
+          run_counts(pars, seed, 0, opt_sims, store)};
+      std::vector<double> const fresh_start{
+          run_counts(pars, seed, opt_sims, 2 * opt_sims, store)};
+      std::vector<double> const fresh_optimum{
+          run_counts(optimum.pars, seed, opt_sims, 2 * opt_sims, store)};
+      std::vector<double> const gain{differences(optimum.counts, searched)};
+      std::vector<double> const fresh_gain{
+          differences(fresh_optimum, fresh_start)};
+
+      std::cout << '\n' << std::setfill('=') << std::setw(53);
+      std::cout << '\n' << "    OPTIMUM: Parameters minimising preys eaten\n\n";
+      print_parameters(optimum.pars);
+      std::cout << std::setw(15) << "seed:  " << seed << "\n\n"
+                << optimum.evaluations << " candidates evaluated on "
+                << opt_sims << " simulations each, " << optimum.iterations
+                << " iterations\n"
+                << std::setprecision(3) << "preys eaten: start "
+                << mean(searched) << ", optimum " << mean(optimum.counts)
+                << "\nchange on the simulations searched: " << mean(gain)
+                << " +- " << ci_half_width(gain, ci_level)
+                << "\nchange on " << opt_sims
+                << " fresh simulations: " << mean(fresh_gain) << " +- "
+                << ci_half_width(fresh_gain, ci_level) << " (95% intervals)\n"
+                << "NB only the boids' rules were searched: the predators'\n"
+                   "rules, the separation from them and the capture radius\n"
+                   "are the ones of the start\n";
+      return EXIT_SUCCESS;
+    }
+
+    // simulations run before the interval of a sequential batch is first
+    // checked, so that it rests on a usable estimate of the variance
+    int const min_sims{10};
+    // with a target width, simulations are run in rounds until the
+    // confidence interval is narrower, or the budget is spent
+    bool const sequential{ci_width > 0.};
+    if (sequential) {
+      is_greater_than(max_sims, min_sims - 1, "max-sims");
+    }
+    int const budget{sequential ? max_sims : simulations};
 
-    std::array<double, simulations> preys_eaten;
+    is_greater_than(formation, -1, "formation-steps");
+    // no more formed flocks than simulations that can start from them
+    is_in_range(snapshots, 0, budget + 1, "snapshots");
+    // formed flocks, copied by the simulations that start from them
+    std::vector<std::vector<Boid>> formed{};
+    if (formation > 0) {
+      for (int k{0}; k != snapshots; ++k) {
+        formed.push_back(warm_start(pars, seed, k, formation));
+      }
+    }
+
+    // configurations run on the same simulations: the seek types in paired
+    // mode, pars otherwise
+    std::vector<Parameters> configurations{};
+    if (paired) {
+      for (int k{0}; k != 3; ++k) {
+        configurations.push_back(pars);
+        configurations.back().set_seek_type() = k;
+      }
+    } else {
+      configurations.push_back(pars);
+    }
+    // preys eaten in every simulation of each configuration
+    std::vector<std::vector<double>> counts(configurations.size());
+    // steps performed by every simulation of the first configuration (more
+    // or fewer than [steps] with adaptive steps)
+    std::vector<int> steps_performed(budget);
+    // logs are allocated before the simulations start, so that recording
+    // captures never allocates within the step loop
+    std::vector<Capture_log> logs{};
+    if (log_capacity > 0 && paired) {
+      throw Invalid_Parameter{"Captures cannot be logged in paired mode"};
+    }
+    if (log_capacity > 0) {
+      logs.assign(budget, Capture_log{log_capacity, log_series ? steps : 0});
+    }
 
-    for (int i{0}; i != simulations; ++i) { // simulation loop
-      // obtains seed to pass to random number engine
-      std::random_device rd;
-      auto const seed{rd()};
-      // fills empty vector with N_boids randomly generated and uses it to
-      // initialize flock
-      std::vector<Boid> boids{};
-      Flock flock{fill(boids, pars, seed)};
-      // adds N_preds randomly generated
-      add_predators(flock, pars, seed);
-      // performs the simulation
-      simulate(flock, pars);
-      preys_eaten[i] = flock.counter();
+    // results of earlier runs, and key of the batch of each configuration.
+    // Lock-step and warm starts change the outcome, workers do not
+    std::optional<Result_cache> cache{};
+    std::vector<std::string> keys{};
+    if (!cache_dir.empty()) {
+      cache.emplace(cache_dir);
+      std::string variant{(formation > 0)
+                              ? "warm " + std::to_string(formation) + ' '
+                                    + std::to_string(snapshots)
+                              : "cold"};
+      if (lanes > 0) {
+        variant += " lock-step";
+      }
+      for (Parameters const& configuration : configurations) {
+        keys.push_back(Result_cache::key(configuration, seed, variant));
+      }
     }
 
-    write_counter(preys_eaten, seek_type); // write count to file for analysis
+    // simulations stepped together, [lanes] at a time (1 if not in lanes)
+    int const group{std::max(lanes, 1)};
+    // runs the simulations [first, last) of the k-th configuration that are
+    // not in the cache (all of them if captures are logged, since the cache
+    // has no logs). Groups run in parallel, unless each simulation already
+    // runs in worker processes
+    auto const run_batch{[&](int k, int first, int last) {
+      Parameters const& batch_pars{configurations[k]};
+      std::vector<double>& preys_eaten{counts[k]};
+      preys_eaten.resize(last);
+      std::vector<int> missing{};
+      for (int i{first}; i != last; ++i) {
+        auto const cached{(cache && logs.empty()) ? cache->find(keys[k], i)
+                                                  : std::nullopt};
+        if (!cached) {
+          missing.push_back(i);
+          continue;
+        }
+        preys_eaten[i] = cached->counter;
+        if (k == 0) {
+          steps_performed[i] = cached->steps;
+        }
+      }
+      int const n_missing{static_cast<int>(missing.size())};
+      // steps performed by each missing simulation
+      std::vector<int> performed(n_missing);
+      int const groups{(n_missing + group - 1) / group};
+      // simulation loop
+      auto const run_group{[&](int g) {
+        int const begin{g * group};
+        int const end{std::min(begin + group, n_missing)};
+        std::vector<Flock> flocks{};
+        for (int m{begin}; m != end; ++m) {
+          int const i{missing[m]};
+          // fills empty vector with N_boids randomly generated (or copies a
+          // formed flock) and uses it to initialize flock
+          std::vector<Boid> boids{};
+          Flock flock{formed.empty() ? fill(boids, batch_pars, seed, i)
+                                     : formed[i % snapshots]};
+          // adds N_preds randomly generated
+          add_predators(flock, batch_pars, seed, i);
+          flocks.push_back(flock);
+        }
+        if (lanes > 0) {
+          Lockstep lockstep{std::move(flocks), batch_pars};
+          for (int m{begin}; m != end; ++m) {
+            if (!logs.empty()) {
+              lockstep.attach(m - begin, &logs[missing[m]]);
+            }
+          }
+          int const steps_done{lockstep.simulate()};
+          for (int m{begin}; m != end; ++m) {
+            performed[m]            = steps_done;
+            preys_eaten[missing[m]] = lockstep.flocks()[m - begin].counter();
+          }
+          return;
+        }
+        Flock& flock{flocks.front()};
+        if (!logs.empty()) {
+          flock.attach(&logs[missing[begin]]);
+        }
+        // performs the simulation
+        performed[begin] =
+            (workers > 0) ? simulate_decomposed(flock, batch_pars, workers)
+                          : simulate(flock, batch_pars);
+        preys_eaten[missing[begin]] = flock.counter();
+      }};
+      if (workers > 0) {
+        for (int g{0}; g != groups; ++g) {
+          run_group(g);
+        }
+      } else {
+        parallel_for(0, groups, run_group, 1);
+      }
+      for (int m{0}; m != n_missing; ++m) {
+        int const i{missing[m]};
+        if (k == 0) {
+          steps_performed[i] = performed[m];
+        }
+        if (cache) {
+          cache->store(keys[k], i,
+                       {static_cast<int>(preys_eaten[i]), performed[m]});
+        }
+      }
+    }};
+
+    // full width of the confidence interval the stopping rule looks at: the
+    // one of the mean count, or the widest one of the paired differences
+    auto const widest_interval{[&]() {
+      if (!paired) {
+        return 2. * ci_half_width(counts[0], ci_level);
+      }
+      double widest{0.};
+      for (int k{0}; k != 3; ++k) {
+        for (int l{k + 1}; l != 3; ++l) {
+          widest = std::max(widest, 2. * ci_half_width(differences(counts[l],
+                                                                   counts[k]),
+                                                       ci_level));
+        }
+      }
+      return widest;
+    }};
+
+    // a round is one group per hardware thread, and the first one has at
+    // least min_sims simulations
+    int const round{
+        group
+        * static_cast<int>(std::max(1u, std::thread::hardware_concurrency()))};
+    int sims{0};
+    while (sims < budget) {
+      int const next{sequential
+                         ? std::min(std::max(sims + round, min_sims), budget)
+                         : budget};
+      for (int k{0}; k != static_cast<int>(configurations.size()); ++k) {
+        run_batch(k, sims, next);
+      }
+      sims = next;
+      if (sequential && widest_interval() < ci_width) {
+        break;
+      }
+    }
+    steps_performed.resize(sims);
+    logs.erase(logs.begin() + std::min(static_cast<int>(logs.size()), sims),
+               logs.end());
+
+    if (paired) {
+      write_paired_counters({counts[0], counts[1], counts[2]});
+    } else {
+      write_counter(counts[0], seek_type); // write count to file for analysis
+    }
+    if (!logs.empty()) {
+      write_capture_logs(logs);
+    }
 
     // printing summary of the parameters used
     std::cout << '\n' << std::setfill('=') << std::setw(53);
     std::cout << '\n' << "    SUMMARY: Parameters used in the simulation\n\n";
     print_parameters(pars);
+    std::cout << std::setw(15) << "seed:  " << seed << "\n\n";
+    if (formation > 0) {
+      std::cout << "warm start: " << formation << " formation steps, "
+                << snapshots << " formed flock(s)\n\n";
+    }
+    if (adaptive) {
+      auto const [min, max]{std::minmax_element(steps_performed.begin(),
+                                                steps_performed.end())};
+      std::cout << "steps per simulation: mean "
+                << std::accumulate(steps_performed.begin(),
+                                   steps_performed.end(), 0.)
+                       / sims
+                << ", min " << *min << ", max " << *max << " (" << steps
+                << " with fixed steps)\n\n";
+    }
+    if (sequential) {
+      double const width{widest_interval()};
+      std::cout << "simulations needed: " << sims << " ("
+                << std::setprecision(0) << 100. * ci_level << "% interval "
+                << (paired ? "of the paired differences " : "")
+                << std::setprecision(3) << width << " wide, "
+                << ((width < ci_width) ? "below " : "budget spent before ")
+                << ci_width << ")\n\n";
+    }
+    if (paired) {
+      print_paired({counts[0], counts[1], counts[2]}, ci_level);
+    }
 
   } catch (Invalid_Parameter const& par_err) {
     std::cerr << "Invalid Parameter: " << par_err.what() << '\n';
@@ -0,0 +1,254 @@
+#include "optimise.hpp"
+#include "flock.hpp"
+#include "parallel.hpp"
+#include "stats.hpp"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <map>
+#include <optional>
+
+// defines the Nelder-Mead search, its bounds and the optimisation of the
+// flying rules
+
+namespace {
+using Point = std::vector<double>;
+
+// preys eaten in simulations [first, last) of the batch of seed, for every
+// candidate: all the simulations of all the candidates share one parallel
+// loop
+std::vector<std::vector<double>>
+candidate_counts(std::vector<Parameters> const& candidates, unsigned int seed,
+                 int first, int last, Result_cache* cache)
+{
+  int const n{static_cast<int>(candidates.size())};
+  std::vector<std::vector<double>> counts(n, std::vector<double>(last - first));
+  std::vector<std::string> keys{};
+  // (candidate, simulation) of the simulations not found in the cache
+  std::vector<std::pair<int, int>> missing{};
+  for (int c{0}; c != n; ++c) {
+    keys.push_back(Result_cache::key(candidates[c], seed, "cold"));
+    for (int i{first}; i != last; ++i) {
+      auto const cached{cache ? cache->find(keys[c], i) : std::nullopt};
+      if (cached) {
+        counts[c][i - first] = cached->counter;
+      } else {
+        missing.emplace_back(c, i);
+      }
+    }
+  }
+  std::vector<int> steps(missing.size());
+  parallel_for(
+      0, static_cast<int>(missing.size()),
+      [&](int m) {
+        auto const [c, i]{missing[m]};
+        Flock const flock{run_simulation(candidates[c], seed, i)};
+        counts[c][i - first] = flock.counter();
+        steps[m]             = flock.step();
+      },
+      1);
+  if (cache) {
+    for (int m{0}; m != static_cast<int>(missing.size()); ++m) {
+      auto const [c, i]{missing[m]};
+      cache->store(keys[c], i,
+                   {static_cast<int>(counts[c][i - first]), steps[m]});
+    }
+  }
+  return counts;
+}
+} // namespace
+
+Simplex_result nelder_mead(Sampler const& sampler, Point const& start,
+                           Point const& steps, int max_evaluations)
+{
+  int const n{static_cast<int>(start.size())};
+  assert(n > 0 && static_cast<int>(steps.size()) == n);
+  is_greater_than(max_evaluations, n, "evaluations");
+  std::map<Point, std::vector<double>> samples{}; // every point sampled
+  std::map<Point, double> means{};
+  // samples the points not sampled yet, unless they exceed the budget (then
+  // returns false)
+  auto const sample{[&](std::vector<Point> const& points) {
+    std::vector<Point> fresh{};
+    for (Point const& p : points) {
+      if (samples.count(p) == 0
+          && std::find(fresh.begin(), fresh.end(), p) == fresh.end()) {
+        fresh.push_back(p);
+      }
+    }
+    if (static_cast<int>(samples.size() + fresh.size()) > max_evaluations) {
+      return false;
+    }
+    auto const values{sampler(fresh)};
+    for (int k{0}; k != static_cast<int>(fresh.size()); ++k) {
+      samples[fresh[k]] = values[k];
+      means[fresh[k]]   = mean(values[k]);
+    }
+    return true;
+  }};
+
+  std::vector<Point> simplex{start};
+  for (int k{0}; k != n; ++k) {
+    simplex.push_back(start);
+    simplex.back()[k] += steps[k];
+  }
+  sample(simplex);
+  auto const sort{[&]() {
+    std::stable_sort(simplex.begin(), simplex.end(),
+                     [&](Point const& p, Point const& q) {
+                       return means.at(p) < means.at(q);
+                     });
+  }};
+  // whether no vertex can be told apart from the best one
+  auto const flat{[&]() {
+    std::vector<double> const& best{samples.at(simplex[0])};
+    for (int k{1}; k != n + 1; ++k) {
+      std::vector<double> const& other{samples.at(simplex[k])};
+      if (best.size() < 2) {
+        if (std::abs(mean(other) - mean(best))
+            > 1e-9 * (1. + std::abs(mean(best)))) {
+          return false;
+        }
+        continue;
+      }
+      std::vector<double> const diffs{differences(other, best)};
+      if (mean(diffs) > ci_half_width(diffs, .95)) {
+        return false;
+      }
+    }
+    return true;
+  }};
+  // whether the simplex shrank to a point, at the resolution of doubles
+  auto const collapsed{[&]() {
+    for (int k{1}; k != n + 1; ++k) {
+      for (int i{0}; i != n; ++i) {
+        if (std::abs(simplex[k][i] - simplex[0][i])
+            > 1e-12 * (1. + std::abs(simplex[0][i]))) {
+          return false;
+        }
+      }
+    }
+    return true;
+  }};
+
+  int iterations{0};
+  while (true) {
+    sort();
+    if (flat() || collapsed()) {
+      break;
+    }
+    ++iterations;
+    Point centroid(n, 0.);
+    for (int k{0}; k != n; ++k) {
+      for (int i{0}; i != n; ++i) {
+        centroid[i] += simplex[k][i] / n;
+      }
+    }
+    Point const worst{simplex[n]};
+    // point of the line through the centroid and the worst vertex (t = 1 is
+    // the worst vertex, t = -1 its reflection)
+    auto const along{[&](double t) {
+      Point p(n);
+      for (int i{0}; i != n; ++i) {
+        p[i] = centroid[i] + t * (worst[i] - centroid[i]);
+      }
+      return p;
+    }};
+    Point const reflected{along(-1.)};
+    if (!sample({reflected})) {
+      break;
+    }
+    double const f_r{means.at(reflected)};
+    if (f_r < means.at(simplex[0])) {
+      Point const expanded{along(-2.)};
+      if (!sample({expanded})) {
+        break;
+      }
+      simplex[n] = (means.at(expanded) < f_r) ? expanded : reflected;
+      continue;
+    }
+    if (f_r < means.at(simplex[n - 1])) {
+      simplex[n] = reflected;
+      continue;
+    }
+    double const f_w{means.at(worst)};
+    Point const contracted{along((f_r < f_w) ? -.5 : .5)};
+    if (!sample({contracted})) {
+      break;
+    }
+    if (means.at(contracted) < std::min(f_r, f_w)) {
+      simplex[n] = contracted;
+      continue;
+    }
+    // shrinks the simplex towards the best vertex
+    std::vector<Point> shrunk{simplex};
+    for (int k{1}; k != n + 1; ++k) {
+      for (int i{0}; i != n; ++i) {
+        shrunk[k][i] = simplex[0][i] + .5 * (simplex[k][i] - simplex[0][i]);
+      }
+    }
+    if (!sample(shrunk)) {
+      break;
+    }
+    simplex = shrunk;
+  }
+  sort();
+  return {simplex[0], samples.at(simplex[0]),
+          static_cast<int>(samples.size()), iterations};
+}
+
+double to_search(double value, double low, double high)
+{
+  assert(value > low && value < high);
+  return std::log((value - low) / (high - value));
+}
+
+// NB far from 0, the logistic function rounds to its limits, which are not
+// in the interval: the nearest doubles inside are returned instead
+double from_search(double x, double low, double high)
+{
+  double const value{low + (high - low) / (1. + std::exp(-x))};
+  return std::clamp(value, std::nextafter(low, high),
+                    std::nextafter(high, low));
+}
+
+std::vector<double> run_counts(Parameters const& pars, unsigned int seed,
+                               int first, int last, Result_cache* cache)
+{
+  return candidate_counts({pars}, seed, first, last, cache)[0];
+}
+
+Optimum optimise_rules(Parameters const& start, unsigned int seed, int sims,
+                       int max_evaluations, Result_cache* cache)
+{
+  is_greater_than(sims, 1, "simulations per evaluation");
+  // open intervals of angle, d_s, s, c and a, as checked by Parameters
+  std::array<std::pair<double, double>, 5> const ranges{
+      {{0., 360.}, {0., .5 * start.get_d()}, {0., 5.}, {0., 5.}, {0., 5.}}};
+  Point const first{start.get_angle(), start.get_d_s(), start.get_s(),
+                    start.get_c(), start.get_a()};
+  auto const candidate{[&](Point const& x) {
+    Point v(5);
+    for (int i{0}; i != 5; ++i) {
+      v[i] = from_search(x[i], ranges[i].first, ranges[i].second);
+    }
+    return start.with_rules(v[0], v[1], v[2], v[3], v[4]);
+  }};
+  Point origin(5);
+  for (int i{0}; i != 5; ++i) {
+    origin[i] = to_search(first[i], ranges[i].first, ranges[i].second);
+  }
+  // a step of .5 moves a value in the middle of its range by an eighth of it
+  Point const steps(5, .5);
+  Sampler const sampler{[&](std::vector<Point> const& points) {
+    std::vector<Parameters> candidates{};
+    for (Point const& x : points) {
+      candidates.push_back(candidate(x));
+    }
+    return candidate_counts(candidates, seed, 0, sims, cache);
+  }};
+  Simplex_result const result{
+      nelder_mead(sampler, origin, steps, max_evaluations)};
+  return {candidate(result.x), result.sample, result.evaluations,
+          result.iterations};
+}
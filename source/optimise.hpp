@@ -0,0 +1,72 @@
+#ifndef OPTIMISE_HPP
+#define OPTIMISE_HPP
+
+#include "cache.hpp"
+#include "parameters.hpp"
+#include <functional>
+#include <vector>
+
+// defines a Nelder-Mead search for noisy objectives and its use on the flying
+// rules, minimising the mean number of preys eaten
+
+// sample of the objective (e.g. one value per simulation) at each of a list of
+// points, computed together so that they can be computed in parallel. Samples
+// of different points must be paired: their i-th values come from the same
+// random numbers
+using Sampler = std::function<std::vector<std::vector<double>>(
+    std::vector<std::vector<double>> const&)>;
+
+struct Simplex_result
+{
+  std::vector<double> x;      // best point
+  std::vector<double> sample; // sample at x
+  int evaluations;            // points sampled (a point is sampled once)
+  int iterations;
+};
+
+// minimises the mean of the sample over points of R^n, starting from a simplex
+// stretched by steps[i] along the i-th axis from start. Samples are stored, so
+// that no point is sampled twice. The search stops after max_evaluations
+// points, or once the simplex is flat: every vertex is indistinguishable from
+// the best one, i.e. the 95% confidence interval of their paired differences
+// holds 0 (or, for samples of one value, the values differ by less than 1e-9
+// in relative terms)
+Simplex_result nelder_mead(Sampler const& sampler,
+                           std::vector<double> const& start,
+                           std::vector<double> const& steps,
+                           int max_evaluations);
+
+// point of the search for a value of the interval (low, high), and back: the
+// whole real line maps onto the open interval, so no point of the search
+// leaves it
+double to_search(double value, double low, double high);
+double from_search(double x, double low, double high);
+
+struct Optimum
+{
+  Parameters pars;
+  std::vector<double> counts; // preys eaten in each simulation
+  int evaluations;
+  int iterations;
+};
+
+// parameters with the flying rules (angle of view, separation distance,
+// separation, cohesion and alignment factors) that minimise the mean preys
+// eaten by simulations [0, sims) of the batch of seed, starting from the ones
+// of start and keeping them within the ranges Parameters accepts. Every
+// candidate runs the same simulations, i.e. the same random numbers: the
+// differences between candidates are not buried in the noise of unrelated
+// batches. Only the regular boids' rules are searched: every candidate faces
+// the predators of start, with their angle of view, separation and pursuit,
+// and keeps the separation from them and the capture radius of start (see
+// Parameters::with_rules). Simulations run in parallel; the ones found in
+// cache (if not null) are not run again, and the ones run are stored there
+Optimum optimise_rules(Parameters const& start, unsigned int seed, int sims,
+                       int max_evaluations, Result_cache* cache);
+
+// preys eaten in simulations [first, last) of the batch of seed, run in
+// parallel (looked up in and stored to cache, if not null)
+std::vector<double> run_counts(Parameters const& pars, unsigned int seed,
+                               int first, int last, Result_cache* cache);
+
+#endif
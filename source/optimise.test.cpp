@@ -0,0 +1,158 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "optimise.hpp"
+#include "flock.hpp"
+#include "stats.hpp"
+#include "doctest.h"
+#include <filesystem>
+
+TEST_CASE("Testing the Nelder-Mead search")
+{
+  SUBCASE("search points map onto open intervals")
+  {
+    CHECK(from_search(to_search(3., 0., 5.), 0., 5.)
+          == doctest::Approx(3.));
+    CHECK(from_search(0., -2., 4.) == doctest::Approx(1.));
+    CHECK(from_search(1e3, 0., 5.) < 5.);
+    CHECK(from_search(-1e3, 0., 5.) > 0.);
+  }
+
+  SUBCASE("exact objective")
+  {
+    int sampled{0};
+    Sampler const sampler{[&](std::vector<std::vector<double>> const& points) {
+      std::vector<std::vector<double>> values{};
+      for (auto const& x : points) {
+        double const u{x[0] - 1.};
+        double const v{x[1] + 2.};
+        values.push_back({u * u + 3. * v * v + u * v});
+        ++sampled;
+      }
+      return values;
+    }};
+    Simplex_result const result{nelder_mead(sampler, {5., 5.}, {1., 1.}, 400)};
+    CHECK(result.x[0] == doctest::Approx(1.).epsilon(1e-3));
+    CHECK(result.x[1] == doctest::Approx(-2.).epsilon(1e-3));
+    CHECK(result.iterations > 0);
+    // no point is sampled twice
+    CHECK(result.evaluations == sampled);
+    CHECK(result.evaluations <= 400);
+  }
+
+  SUBCASE("paired noise cancels out")
+  {
+    // the i-th value of every sample shares the same large noise, as the i-th
+    // simulations of candidates share their random numbers
+    std::vector<double> const noise{9., -7., 3., -12., 6., 1., -4., 8.};
+    Sampler const sampler{[&](std::vector<std::vector<double>> const& points) {
+      std::vector<std::vector<double>> values{};
+      for (auto const& x : points) {
+        std::vector<double> sample{};
+        for (int i{0}; i != 8; ++i) {
+          double const u{x[0] - 3.};
+          sample.push_back(u * u * (1. + .1 * (i % 2)) + noise[i]);
+        }
+        values.push_back(sample);
+      }
+      return values;
+    }};
+    Simplex_result const result{nelder_mead(sampler, {0.}, {.5}, 200)};
+    CHECK(result.x[0] == doctest::Approx(3.).epsilon(.05));
+    CHECK(result.sample.size() == 8u);
+  }
+
+  SUBCASE("the budget is respected")
+  {
+    Sampler const sampler{[](std::vector<std::vector<double>> const& points) {
+      std::vector<std::vector<double>> values{};
+      for (auto const& x : points) {
+        values.push_back({x[0] * x[0] + x[1] * x[1]});
+      }
+      return values;
+    }};
+    CHECK(nelder_mead(sampler, {5., 5.}, {1., 1.}, 10).evaluations <= 10);
+    CHECK_THROWS_AS(nelder_mead(sampler, {5., 5.}, {1., 1.}, 2),
+                    Invalid_Parameter);
+  }
+}
+
+TEST_CASE("Testing the optimisation of the flying rules")
+{
+  Parameters const start{300., 35., 3.5, .7, .045, .8, 80., .05,
+                         10.,  100,  10, 100, 30,  1,  1};
+  auto const dir{std::filesystem::temp_directory_path() / "boids-optimise.t"};
+  std::filesystem::remove_all(dir);
+  Result_cache cache{dir.string()};
+  Optimum const optimum{optimise_rules(start, 5u, 4, 12, &cache)};
+  CHECK(optimum.evaluations <= 12);
+  CHECK(optimum.counts.size() == 4u);
+  // the start is a vertex of the first simplex, and candidates run the same
+  // simulations
+  std::vector<double> const first{run_counts(start, 5u, 0, 4, nullptr)};
+  CHECK(mean(optimum.counts) <= mean(first));
+  Parameters const& best{optimum.pars};
+  CHECK(best.get_angle() > 0.);
+  CHECK(best.get_angle() < 360.);
+  CHECK(best.get_d_s() < .5 * best.get_d());
+  CHECK(best.get_s() < 5.);
+  CHECK(best.get_steps() == start.get_steps());
+  CHECK(best.get_seek_type() == 1);
+  // the predators are not weakened: same capture radius and separation from
+  // them
+  CHECK(best.get_d_s_pred() / 24.5 == start.get_d_s_pred() / 24.5);
+  CHECK(best.get_s_pred() == start.get_s_pred());
+  // counts are those of the simulations of best, and were cached
+  CHECK(run_counts(best, 5u, 0, 4, nullptr) == optimum.counts);
+  Result_cache reopened{dir.string()};
+  std::string const key{Result_cache::key(best, 5u, "cold")};
+  for (int i{0}; i != 4; ++i) {
+    REQUIRE(reopened.find(key, i).has_value());
+    CHECK(reopened.find(key, i)->counter == optimum.counts[i]);
+  }
+  // a second search finds everything it needs in the cache
+  Optimum const again{optimise_rules(start, 5u, 4, 12, &reopened)};
+  CHECK(again.counts == optimum.counts);
+  std::filesystem::remove_all(dir);
+}
+
+TEST_CASE("Testing the optimisation of the flying rules with seek type 2")
+{
+  // predators chase the center of mass of the boids in sight, through the
+  // cohesion rule
+  Parameters const start{300., 35., 3.5, .7, .045, .8, 80., .05,
+                         10.,  100,  10, 100, 30,  2,  2};
+  Optimum const optimum{optimise_rules(start, 5u, 4, 12, nullptr)};
+  Parameters const& best{optimum.pars};
+  CHECK(best.get_seek_type() == 2);
+  CHECK(best.get_pred_angle() == start.get_angle());
+  CHECK(best.get_pred_d_s() == start.get_d_s());
+  CHECK(best.get_pred_s() == start.get_s());
+  CHECK(best.get_pred_c() == start.get_c());
+  // the predators' pursuit and separation from each other are the ones of
+  // start, whatever the rules searched: the optimum and a candidate far from
+  // start
+  std::vector<Boid> boids;
+  Flock flock{fill(boids, start, 5u)};
+  add_predators(flock, start, 5u);
+  Parameters const far{start.with_rules(90., 1., 4., 4.5, .1)};
+  for (int i : flock.pred_indices()) {
+    Boid const& pred{flock.state()[i]};
+    Velocity const pursuit{seek(pred, flock, start)};
+    Velocity const apart{separation(pred, flock, start)};
+    for (Parameters const& pars : {best, far}) {
+      CHECK(seek(pred, flock, pars).x() == pursuit.x());
+      CHECK(seek(pred, flock, pars).y() == pursuit.y());
+      CHECK(separation(pred, flock, pars).x() == apart.x());
+      CHECK(separation(pred, flock, pars).y() == apart.y());
+    }
+  }
+  // while the boids' cohesion did change
+  bool changed{false};
+  for (Boid const& boid : flock.state()) {
+    if (!boid.is_pred()) {
+      Velocity const v{cohesion(boid, flock, far)};
+      Velocity const v0{cohesion(boid, flock, start)};
+      changed = changed || v.x() != v0.x() || v.y() != v0.y();
+    }
+  }
+  CHECK(changed);
+}
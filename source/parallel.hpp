@@ -0,0 +1,48 @@
+#ifndef PARALLEL_HPP
+#define PARALLEL_HPP
+
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+// defines parallel_for, splitting a range of indices among hardware threads
+
+// calls f(i) for every i in [first, last). The range is split into contiguous
+// chunks, one per hardware thread; ranges shorter than grain are run on the
+// calling thread, since spawning threads would cost more than it saves. f must
+// be safe to call concurrently for different indices
+template<class F>
+void parallel_for(int first, int last, F f, int grain = 4096)
+{
+  int const size{last - first};
+  int const n_threads{std::min(
+      static_cast<int>(std::max(1u, std::thread::hardware_concurrency())),
+      size / std::max(grain, 1))};
+  if (n_threads <= 1) {
+    for (int i{first}; i != last; ++i) {
+      f(i);
+    }
+    return;
+  }
+  std::vector<std::thread> threads;
+  threads.reserve(n_threads - 1);
+  int const chunk{(size + n_threads - 1) / n_threads};
+  for (int t{1}; t != n_threads; ++t) {
+    int const begin{first + t * chunk};
+    int const end{std::min(begin + chunk, last)};
+    threads.emplace_back([=, &f]() {
+      for (int i{begin}; i < end; ++i) {
+        f(i);
+      }
+    });
+  }
+  // the calling thread takes the first chunk
+  for (int i{first}; i != first + chunk; ++i) {
+    f(i);
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+}
+
+#endif
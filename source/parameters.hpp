@@ -33,6 +33,24 @@ void is_greater_than(T val, T val_min, std::string par_name)
   }
 }
 
+// schemes advancing boids' positions over a step (see integrate in flock.cpp)
+enum class Integrator
+{
+  euler,         // explicit Euler: moves with the velocity at step's start
+  semi_implicit, // semi-implicit Euler: moves with the velocity at step's end
+  verlet         // velocity-Verlet-like: moves with the mean of the two
+};
+
+// ways of finding the boids a query selects (same selection, different cost)
+enum class Engine
+{
+  brute_force, // every boid of the flock is checked
+  grid,        // only boids in the cells within reach are checked (see Grid)
+  quadtree,    // only boids in the quadrants within reach (see Quadtree)
+  tiled,       // every pair of boids is checked once per step (see Tiles)
+  automatic    // the fastest for the flock, as timed (see Flock::evolve)
+};
+
 class Parameters
 {
   // values depending on user input:
@@ -52,13 +70,63 @@ class Parameters
   int N_preds_;
   double d_s_pred_; // separation distance for predators
   double s_pred_;   // separation factor for predators
-  int seek_type_;   // 0 for nearest, 1 for isolated, 2 for COM
+  // predators' own rules: angle of view, separation distance and factor from
+  // each other, cohesion factor (seek type 2)
+  double pred_angle_;
+  double pred_d_s_;
+  double pred_s_;
+  double pred_c_;
+  int seek_type_; // 0 for nearest, 1 for isolated, 2 for COM
 
   // values set by developer:
   double x_min_{0.};
   double y_min_{0.};
   double x_max_{100.};
   double y_max_{100.};
+  // if true, captures are detected along the whole step instead of only at
+  // its end (see is_victim)
+  bool swept_capture_{false};
+  Integrator integrator_{Integrator::euler};
+  // if true, step length is chosen at every step (see Flock::next_step)
+  bool adaptive_steps_{false};
+  // if > 0, the flock is sorted along a space-filling curve every
+  // [reorder_interval] steps (see Flock::reorder)
+  int reorder_interval_{0};
+  Engine engine_{Engine::brute_force};
+  // if true, the grid and quadtree engines skip the regions of space out of a
+  // boid's field of view (see View_cone)
+  bool view_culling_{true};
+  // if true, cohesion and alignment add up neighbours a cell at a time where
+  // possible, counting whole the cells within (1 + tolerance) d and dropping
+  // the ones beyond (1 - tolerance) d (see far_field)
+  bool far_field_{false};
+  double far_field_tolerance_{0.};
+  // if true, the box is a torus: boids leaving it through a border re-enter it
+  // through the opposite one, and see each other across borders by their
+  // nearest images (see Flock::evolve)
+  bool periodic_{false};
+
+  void validate()
+  {
+    is_in_range(angle_, 0., 360., "angle-of-view");
+    is_in_range(d_, 0., std::min(x_max_, y_max_), "neighbour-distance");
+    // d_s has to be significantly less than d for the flock to form
+    is_in_range(d_s_, 0., 0.5 * d_, "separation-distance");
+    is_in_range(s_, 0., 5., "separation-factor");
+    is_in_range(c_, 0., 5., "cohesion-factor");
+    is_in_range(a_, 0., 5., "alignment-factor");
+    is_greater_than(max_speed_, 0., "maximum-speed");
+    is_in_range(min_speed_, 0., max_speed_, "minimum-speed");
+    is_greater_than(duration_, 0., "duration-of-simulation{s}");
+    is_greater_than(steps_, 1, "number-of-evolutions");
+    // guarantees that at least two flock's states are printed
+    is_in_range(prescale_or_fps_, 0, prescale_or_fps_limit_, "prescale");
+    is_greater_than(N_boids_, 1, "number-of-boids");
+    is_greater_than(N_preds_, 0, "number-of-preds");
+    is_in_range(seek_type_, -1, 3, "seek-type");
+
+    assert(invariant());
+  }
 
   bool invariant()
   {
@@ -95,27 +163,32 @@ class Parameters
       , N_preds_{N_preds}
       , d_s_pred_{7. * d_s} // boids' separation rule from predators has larger
       , s_pred_{10.5 * s}   // separation distance and highest separation factor
+      , pred_angle_{angle} // predators fly by the boids' rules
+      , pred_d_s_{d_s}
+      , pred_s_{s}
+      , pred_c_{c}
       , seek_type_{seek_type}
 
   {
-    is_in_range(angle_, 0., 360., "angle-of-view");
-    is_in_range(d_, 0., std::min(x_max_, y_max_), "neighbour-distance");
-    // d_s has to be significantly less than d for the flock to form
-    is_in_range(d_s_, 0., 0.5 * d_, "separation-distance");
-    is_in_range(s_, 0., 5., "separation-factor");
-    is_in_range(c_, 0., 5., "cohesion-factor");
-    is_in_range(a_, 0., 5., "alignment-factor");
-    is_greater_than(max_speed_, 0., "maximum-speed");
-    is_in_range(min_speed_, 0., max_speed_, "minimum-speed");
-    is_greater_than(duration_, 0., "duration-of-simulation{s}");
-    is_greater_than(steps_, 1, "number-of-evolutions");
-    // guarantees that at least two flock's states are printed
-    is_in_range(prescale_or_fps_, 0, prescale_or_fps_limit_, "prescale");
-    is_greater_than(N_boids_, 1, "number-of-boids");
-    is_greater_than(N_preds_, 0, "number-of-preds");
-    is_in_range(seek_type_, -1, 3, "seek-type");
+    validate();
+  }
 
-    assert(invariant());
+  // copy with other flying rules (see optimise_rules), checked as by the
+  // constructor: throws Invalid_Parameter if they are out of range. Only
+  // the regular boids' rules change: the separation from predators (d_s_pred
+  // also sets the capture radius) and the predators' own rules keep the
+  // values of *this
+  Parameters with_rules(double angle, double d_s, double s, double c,
+                        double a) const
+  {
+    Parameters pars{*this};
+    pars.angle_ = angle;
+    pars.d_s_   = d_s;
+    pars.s_     = s;
+    pars.c_     = c;
+    pars.a_     = a;
+    pars.validate();
+    return pars;
   }
 
   // clang-format off
@@ -140,7 +213,31 @@ class Parameters
   double& set_y_max(){return y_max_;}
   double get_d_s_pred() const{return d_s_pred_;}
   double get_s_pred() const{return s_pred_;}
+  double get_pred_angle() const{return pred_angle_;}
+  double get_pred_d_s() const{return pred_d_s_;}
+  double get_pred_s() const{return pred_s_;}
+  double get_pred_c() const{return pred_c_;}
   int get_seek_type() const{return seek_type_;}
+  // NB not validated: seek types other than 0, 1 and 2 are not supported
+  int& set_seek_type(){return seek_type_;}
+  bool get_swept_capture() const{return swept_capture_;}
+  bool& set_swept_capture(){return swept_capture_;}
+  Integrator get_integrator() const{return integrator_;}
+  Integrator& set_integrator(){return integrator_;}
+  bool get_adaptive_steps() const{return adaptive_steps_;}
+  bool& set_adaptive_steps(){return adaptive_steps_;}
+  int get_reorder_interval() const{return reorder_interval_;}
+  int& set_reorder_interval(){return reorder_interval_;}
+  Engine get_engine() const{return engine_;}
+  Engine& set_engine(){return engine_;}
+  bool get_view_culling() const{return view_culling_;}
+  bool& set_view_culling(){return view_culling_;}
+  bool get_far_field() const{return far_field_;}
+  bool& set_far_field(){return far_field_;}
+  double get_far_field_tolerance() const{return far_field_tolerance_;}
+  double& set_far_field_tolerance(){return far_field_tolerance_;}
+  bool get_periodic() const{return periodic_;}
+  bool& set_periodic(){return periodic_;}
   // clang-format on
 };
 
@@ -87,4 +87,31 @@ TEST_CASE("testing Parameters")
                                   -19., -22, -5, -22, -20}),
                       ("Parameter angle-of-view is not in the required range"));
   }
+
+  SUBCASE("copies with other flying rules are checked")
+  {
+    Parameters const pars{150., 40., 8.5, 1., 1.5, 2., 155., .2, 85.,
+                          1000, 10, 1000, 3};
+    Parameters const other{pars.with_rules(90., 4., 2., .5, 1.)};
+    CHECK(other.get_angle() == 90.);
+    CHECK(other.get_d_s() == 4.);
+    CHECK(other.get_s() == 2.);
+    CHECK(other.get_c() == .5);
+    CHECK(other.get_a() == 1.);
+    // the separation from predators, and so the capture radius, is kept
+    CHECK(other.get_d_s_pred() == pars.get_d_s_pred());
+    CHECK(other.get_s_pred() == pars.get_s_pred());
+    // and so are the predators' own rules, the boids' ones by construction
+    CHECK(pars.get_pred_angle() == pars.get_angle());
+    CHECK(other.get_pred_angle() == pars.get_angle());
+    CHECK(other.get_pred_d_s() == pars.get_d_s());
+    CHECK(other.get_pred_s() == pars.get_s());
+    CHECK(other.get_pred_c() == pars.get_c());
+    CHECK(other.get_d() == pars.get_d());
+    CHECK(other.get_steps() == pars.get_steps());
+    CHECK_THROWS_WITH(pars.with_rules(90., 20., 2., .5, 1.),
+                      "Parameter separation-distance is not in the required "
+                      "range");
+    CHECK_THROWS_AS(pars.with_rules(90., 4., 2., .5, 5.), Invalid_Parameter);
+  }
 }
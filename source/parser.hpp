@@ -10,7 +10,14 @@ inline auto get_parser(double& angle, double& d, double& d_s, double& s,
                        double& c, double& a, double& max_speed,
                        double& min_speed_fraction, double& duration, int& steps,
                        int& prescale, int& N_boids, int& N_preds,
-                       bool& show_help, int& seek_type)
+                       bool& show_help, int& seek_type, unsigned int& seed,
+                       int& log_capacity, bool& log_series, bool& swept,
+                       int& integrator, bool& adaptive, int& reorder,
+                       int& engine, double& far_field, bool& periodic,
+                       int& workers, int& lanes, int& formation,
+                       int& snapshots, bool& paired, double& ci_width,
+                       int& max_sims, std::string& cache_dir, int& optimise,
+                       int& opt_sims)
 {
   return lyra::cli{
       lyra::help(show_help)
@@ -57,7 +64,91 @@ inline auto get_parser(double& angle, double& d, double& d_s, double& s,
           "1]")
       | lyra::opt(seek_type, "seek-type")["--seek-type"](
           "Set the seek type  [Default value is "
-          "0]")};
+          "0]")
+      | lyra::opt(seed, "seed")["--seed"](
+          "Set the seed of the batch of simulations, to reproduce a previous "
+          "one  [Default value is drawn from std::random_device]")
+      | lyra::opt(log_capacity, "log-capacity")["--log-captures"](
+          "Record up to [log-capacity] capture events per simulation to file "
+          "capture_events.txt  [Default value is 0, i.e. disabled]")
+      | lyra::opt(log_series)["--log-series"](
+          "Together with --log-captures, also record the number of preys "
+          "eaten after each step to file counter_series.txt")
+      | lyra::opt(swept)["--swept-capture"](
+          "Detect captures along the whole step instead of only at its end, "
+          "so that fewer steps can be used")
+      | lyra::opt(integrator, "integrator")["--integrator"](
+          "Set the integrator: 0 for explicit Euler, 1 for semi-implicit "
+          "Euler, 2 for velocity Verlet  [Default value is 0]")
+      | lyra::opt(adaptive)["--adaptive"](
+          "Adapt the steps, keeping the duration: shorten them (down to a "
+          "quarter of duration/steps) while a capture or a wall is within "
+          "reach, lengthen them (up to 8 times) while none is and the flock "
+          "is cruising")
+      | lyra::opt(reorder, "reorder-interval")["--reorder"](
+          "Sort boids in memory by position every [reorder-interval] steps, "
+          "to speed up large flocks  [Default value is 0, i.e. never]")
+      | lyra::opt(engine, "engine")["--engine"](
+          "Set how neighbours are looked for: 0 checking every boid, 1 "
+          "through a grid of cells, 2 through a quadtree, 3 checking every "
+          "pair once per step, 4 the fastest of them as timed  [Default value "
+          "is 0]")
+      | lyra::opt(far_field, "tolerance")["--far-field"](
+          "Approximate cohesion and alignment from sums over grid cells, "
+          "taking whole the cells within (1 + tolerance) times the neighbour "
+          "distance, with tolerance in [0, 1)  [Default: exact rules]")
+      | lyra::opt(periodic)["--periodic"](
+          "Wrap the box into a torus: boids crossing a border re-enter "
+          "through the opposite one and see each other across borders. "
+          "Neighbour distance and 7 times separation distance must be less "
+          "than half the box side")
+      | lyra::opt(workers, "workers")["--workers"](
+          "Split the box into vertical strips, each simulated by its own "
+          "process exchanging boids with the others at every step. Not "
+          "available with adaptive steps, periodic world, far-field sums, "
+          "reordering or capture logs  [Default: a single process]")
+      | lyra::opt(lanes, "lanes")["--lanes"](
+          "Step up to 16 simulations at once, computing the rules of their "
+          "regular boids in vectorized loops. Statistically, not bitwise, "
+          "equivalent to one at a time. Not available with workers, "
+          "adaptive steps, periodic world or far-field sums  [Default: one "
+          "at a time]")
+      | lyra::opt(formation, "formation-steps")["--warm-start"](
+          "Start every simulation from a flock already formed: its regular "
+          "boids are first evolved for this number of steps with no "
+          "predators, then the predators of the simulation are added  "
+          "[Default: 0, i.e. cold start from random positions]")
+      | lyra::opt(snapshots, "snapshots")["--snapshots"](
+          "Number of formed flocks the simulations of a warm start share, "
+          "the i-th simulation starting from the (i mod snapshots)-th one. "
+          "At most the number of simulations  [Default: 1]")
+      | lyra::opt(paired)["--paired"](
+          "Run every simulation with each of the three seek types, from the "
+          "same flock and predators, and report the paired differences of "
+          "the preys eaten with their 95% confidence intervals. Seek type "
+          "is ignored, and captures cannot be logged")
+      | lyra::opt(ci_width, "width")["--ci-width"](
+          "Instead of 100 simulations, run rounds of simulations in parallel "
+          "until the 95% confidence interval of the mean preys eaten (in "
+          "paired mode, of every paired difference) is narrower than width, "
+          "or --max-sims simulations were run  [Default: 100 simulations]")
+      | lyra::opt(max_sims, "max-sims")["--max-sims"](
+          "Budget of simulations of --ci-width, at least 10  [Default: "
+          "1000]")
+      | lyra::opt(cache_dir, "directory")["--cache"](
+          "Keep the preys eaten and the steps of every simulation in "
+          "directory, and only run the simulations not found there. Results "
+          "are keyed by all the parameters, the seed and the version of the "
+          "simulation code  [Default: no cache]")
+      | lyra::opt(optimise, "evaluations")["--optimise"](
+          "Search (Nelder-Mead) the angle of view, separation distance and "
+          "separation, cohesion and alignment factors minimising the preys "
+          "eaten, starting from the given ones, within this number of "
+          "candidates. Every candidate runs the same --opt-sims simulations "
+          "in parallel, and the optimum is checked on as many fresh ones. "
+          "Candidates are reused through --cache")
+      | lyra::opt(opt_sims, "opt-sims")["--opt-sims"](
+          "Simulations per candidate of --optimise  [Default: 20]")};
 }
 
 // prints summary of values of parameters used in the simulation
@@ -0,0 +1,85 @@
+#include "quadtree.hpp"
+
+// defines Quadtree's construction
+
+void Quadtree::build(std::vector<Boid> const& boids, Parameters const& pars)
+{
+  boids_ = &boids;
+  nodes_.clear();
+  items_.clear();
+  // the root covers the box and any boid slightly out of it (bound_position
+  // only steers them back), so that every boid lies within its leaf's bounds
+  Node root{pars.get_x_min(), pars.get_y_min(), pars.get_x_max(),
+            pars.get_y_max(), -1,                0,
+            0};
+  for (int i{0}; i != static_cast<int>(boids.size()); ++i) {
+    Boid const& b{boids[i]};
+    if (!b.is_pred() && !b.is_eaten()) {
+      items_.push_back(i);
+      root.x0 = std::min(root.x0, b.position().x());
+      root.y0 = std::min(root.y0, b.position().y());
+      root.x1 = std::max(root.x1, b.position().x());
+      root.y1 = std::max(root.y1, b.position().y());
+    }
+  }
+  root.end = static_cast<int>(items_.size());
+  nodes_.push_back(root);
+  split(0, 0);
+}
+
+// boids of a node are partitioned in place among its quadrants: left of the
+// vertical midline, then below or above the horizontal one on each side
+void Quadtree::split(int node, int depth)
+{
+  Node const n{nodes_[node]};
+  if (n.end - n.begin <= leaf_size || depth == max_depth) {
+    return;
+  }
+  double const x_mid{.5 * (n.x0 + n.x1)};
+  double const y_mid{.5 * (n.y0 + n.y1)};
+  std::vector<Boid> const& boids{*boids_};
+  auto const first{items_.begin() + n.begin};
+  auto const last{items_.begin() + n.end};
+  auto const x_split{std::partition(
+      first, last, [&](int i) { return boids[i].position().x() < x_mid; })};
+  auto const below{[&](int i) { return boids[i].position().y() < y_mid; }};
+  auto const left_split{std::partition(first, x_split, below)};
+  auto const right_split{std::partition(x_split, last, below)};
+  int const bounds[5]{n.begin, static_cast<int>(left_split - items_.begin()),
+                      static_cast<int>(x_split - items_.begin()),
+                      static_cast<int>(right_split - items_.begin()), n.end};
+  int const child{static_cast<int>(nodes_.size())};
+  nodes_[node].child = child;
+  // NB nodes_ may reallocate here: n is a copy
+  nodes_.push_back({n.x0, n.y0, x_mid, y_mid, -1, bounds[0], bounds[1]});
+  nodes_.push_back({n.x0, y_mid, x_mid, n.y1, -1, bounds[1], bounds[2]});
+  nodes_.push_back({x_mid, n.y0, n.x1, y_mid, -1, bounds[2], bounds[3]});
+  nodes_.push_back({x_mid, y_mid, n.x1, n.y1, -1, bounds[3], bounds[4]});
+  for (int c{0}; c != 4; ++c) {
+    split(child + c, depth + 1);
+  }
+}
+
+int Quadtree::depth() const
+{
+  // children are always pushed after their parent: depths are found in one
+  // pass
+  std::vector<int> depths(nodes_.size(), 0);
+  int max{0};
+  for (int i{0}; i != size(); ++i) {
+    if (nodes_[i].child != -1) {
+      for (int c{0}; c != 4; ++c) {
+        depths[nodes_[i].child + c] = depths[i] + 1;
+        max = std::max(max, depths[i] + 1);
+      }
+    }
+  }
+  return max;
+}
+
+void Quadtree::clear()
+{
+  boids_ = nullptr;
+  nodes_.clear();
+  items_.clear();
+}
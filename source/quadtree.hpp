@@ -0,0 +1,174 @@
+#ifndef QUADTREE_HPP
+#define QUADTREE_HPP
+
+#include "boids.hpp"
+#include "parameters.hpp"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+// defines Quadtree, an adaptive index of the alive regular boids of a flock by
+// position
+
+// the box of the simulation is split in four quadrants, recursively, until a
+// quadrant holds at most leaf_size boids: dense regions (the flock, the corner
+// refuges) get small quadrants and empty ones are not split at all. Boids are
+// referred to by their index in the flock
+class Quadtree
+{
+  struct Node
+  {
+    double x0, y0, x1, y1; // bounds
+    int child;             // first of the four children, -1 for leaves
+    int begin, end;        // range of items_ holding the node's boids
+  };
+  std::vector<Node> nodes_; // nodes_[0] is the root
+  std::vector<int> items_;  // indices of the boids, grouped by leaf
+  std::vector<Boid> const* boids_{nullptr};
+
+  void split(int node, int depth);
+
+ public:
+  static constexpr int leaf_size{8};
+  // quadrants are not split below this depth (coinciding boids would be split
+  // forever)
+  static constexpr int max_depth{16};
+
+  bool built() const
+  {
+    return boids_ != nullptr;
+  }
+  int size() const
+  {
+    return static_cast<int>(nodes_.size());
+  }
+  int depth() const;
+  // indexes the alive regular boids of boids, which must outlive the tree (or
+  // the next build)
+  void build(std::vector<Boid> const& boids, Parameters const& pars);
+  void clear();
+
+  // calls f(i) for every indexed boid in a leaf intersecting the circle of
+  // radius r centred in p. Quadrants are skipped only if all their points are
+  // surely at distance >= r, so no boid with distance() < r is missed, or if
+  // keep(x0, y0, x1, y1) is false for their bounds
+  template<class F, class Keep>
+  void for_each_near(Position const& p, double r, F f, Keep keep) const
+  {
+    assert(built());
+    // depth-first: at most 3 pending siblings per level, plus the 4 children
+    // of the deepest node
+    std::array<int, 3 * max_depth + 4> stack;
+    int top{0};
+    stack[top++] = 0;
+    while (top != 0) {
+      Node const& node{nodes_[stack[--top]]};
+      double const dx{std::max({node.x0 - p.x(), 0., p.x() - node.x1})};
+      double const dy{std::max({node.y0 - p.y(), 0., p.y() - node.y1})};
+      if (std::sqrt(dx * dx + dy * dy) >= r
+          || !keep(node.x0, node.y0, node.x1, node.y1)) {
+        continue;
+      }
+      if (node.child == -1) {
+        for (int k{node.begin}; k != node.end; ++k) {
+          f(items_[k]);
+        }
+      } else {
+        for (int c{0}; c != 4; ++c) {
+          stack[top++] = node.child + c;
+        }
+      }
+    }
+  }
+  template<class F>
+  void for_each_near(Position const& p, double r, F f) const
+  {
+    for_each_near(p, r, f, [](double, double, double, double) { return true; });
+  }
+  // index of the indexed boid closest to p among the ones accept(i) is true
+  // for (the lowest index among equally close ones), -1 if none is. Branch
+  // and bound: quadrants are visited nearest first and skipped when farther
+  // than the best boid found, or when keep(x0, y0, x1, y1) is false for their
+  // bounds. accept is only called for boids closer than the best one
+  template<class Accept, class Keep>
+  int nearest(Position const& p, Accept accept, Keep keep) const
+  {
+    assert(built());
+    std::array<int, 3 * max_depth + 4> stack;
+    int top{0};
+    stack[top++] = 0;
+    int best{-1};
+    double best_d2{std::numeric_limits<double>::infinity()};
+    auto const box_d2{[&](Node const& node) {
+      double const dx{std::max({node.x0 - p.x(), 0., p.x() - node.x1})};
+      double const dy{std::max({node.y0 - p.y(), 0., p.y() - node.y1})};
+      return dx * dx + dy * dy;
+    }};
+    while (top != 0) {
+      Node const& node{nodes_[stack[--top]]};
+      // ties are kept: an equally close boid may have a lower index
+      if (box_d2(node) > best_d2
+          || !keep(node.x0, node.y0, node.x1, node.y1)) {
+        continue;
+      }
+      if (node.child == -1) {
+        for (int k{node.begin}; k != node.end; ++k) {
+          int const i{items_[k]};
+          double const d2{squared_distance(p, (*boids_)[i].position())};
+          if ((d2 < best_d2 || (d2 == best_d2 && i < best)) && accept(i)) {
+            best    = i;
+            best_d2 = d2;
+          }
+        }
+      } else {
+        // pushed farthest first, so that the nearest is popped first
+        std::array<std::pair<double, int>, 4> children;
+        for (int c{0}; c != 4; ++c) {
+          children[c] = {box_d2(nodes_[node.child + c]), node.child + c};
+        }
+        std::sort(children.begin(), children.end(),
+                  [](auto const& a, auto const& b) { return a > b; });
+        for (auto const& child : children) {
+          stack[top++] = child.second;
+        }
+      }
+    }
+    return best;
+  }
+  template<class Accept>
+  int nearest(Position const& p, Accept accept) const
+  {
+    return nearest(p, accept,
+                   [](double, double, double, double) { return true; });
+  }
+  // fills indices with the alive indexed boids seen by viewer within angle and
+  // closer than r (the selection of neighbours), in increasing order. Unless
+  // cull is false, quadrants out of viewer's field of view are skipped
+  template<class Indices>
+  Indices& select(Boid const& viewer, double angle, double r, Indices& indices,
+                  bool cull = true) const
+  {
+    View_cone const cone{viewer, angle};
+    auto const selected{[&](int i) {
+      Boid const& other{(*boids_)[i]};
+      if (!other.is_eaten() && is_seen(viewer, other, angle)
+          && distance(viewer, other) < r) {
+        indices.push_back(i);
+      }
+    }};
+    if (cull) {
+      for_each_near(viewer.position(), r, selected,
+                    [&](double x0, double y0, double x1, double y1) {
+                      return cone.may_see(x0, y0, x1, y1);
+                    });
+    } else {
+      for_each_near(viewer.position(), r, selected);
+    }
+    std::sort(indices.begin(), indices.end());
+    return indices;
+  }
+};
+
+#endif
@@ -0,0 +1,133 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "quadtree.hpp"
+#include "doctest.h"
+#include "random.hpp"
+
+namespace {
+// selection of neighbours by checking every boid
+std::vector<int> brute_force(std::vector<Boid> const& boids,
+                             Boid const& viewer, double angle, double r)
+{
+  std::vector<int> selected;
+  for (int i{0}; i != static_cast<int>(boids.size()); ++i) {
+    Boid const& b{boids[i]};
+    if (!b.is_pred() && !b.is_eaten() && is_seen(viewer, b, angle)
+        && distance(viewer, b) < r) {
+      selected.push_back(i);
+    }
+  }
+  return selected;
+}
+
+// nearest boid seen by viewer, by checking every boid
+int brute_nearest(std::vector<Boid> const& boids, Boid const& viewer,
+                  double angle)
+{
+  std::vector<int> const seen{
+      brute_force(boids, viewer, angle, std::numeric_limits<double>::max())};
+  auto const nearest{std::min_element(
+      seen.begin(), seen.end(), [&](int i, int j) {
+        return squared_distance(viewer.position(), boids[i].position())
+             < squared_distance(viewer.position(), boids[j].position());
+      })};
+  return (nearest == seen.end()) ? -1 : *nearest;
+}
+
+// n boids around (x, y), within spread, with random headings
+std::vector<Boid>& scatter(std::vector<Boid>& boids, int n, double x, double y,
+                           double spread, std::uint32_t seed)
+{
+  Philox const gen{seed, 0u, Stream::preys};
+  for (int i{0}; i != n; ++i) {
+    auto const bits{gen(i)};
+    Position const p{x + uniform(bits[0], -spread, spread),
+                     y + uniform(bits[1], -spread, spread)};
+    Velocity const v{uniform(bits[2], -1., 1.), uniform(bits[3], .1, 1.)};
+    // a few predators, which are not indexed
+    boids.push_back((i % 17 == 0) ? Boid{p, v, true} : Boid{p, v});
+  }
+  return boids;
+}
+} // namespace
+
+TEST_CASE("testing quadtree")
+{
+  Parameters const pars{90.,     5.,  2., 1., 1., 1., 100,
+                        .000005, 10., 10, 2,  10, 40};
+  std::vector<Boid> boids;
+  Quadtree tree;
+  CHECK_FALSE(tree.built());
+
+  SUBCASE("queries match brute force on uniform boids")
+  {
+    scatter(boids, 400, 50., 50., 50., 1u);
+    boids[3].is_eaten() = true;
+    tree.build(boids, pars);
+    CHECK(tree.built());
+    for (int v{0}; v < 400; v += 7) {
+      for (double angle : {90., 300.}) {
+        for (double r : {1., 5., 30.}) {
+          std::vector<int> selected;
+          tree.select(boids[v], angle, r, selected);
+          CHECK(selected == brute_force(boids, boids[v], angle, r));
+        }
+      }
+    }
+  }
+
+  SUBCASE("nearest matches brute force")
+  {
+    scatter(boids, 400, 50., 50., 50., 6u);
+    boids[10] = Boid{boids[11].position(), {1., 0.}}; // a tie
+    tree.build(boids, pars);
+    for (int v{0}; v < 400; v += 3) {
+      for (double angle : {30., 300.}) {
+        Boid const& viewer{boids[v]};
+        int const nearest{tree.nearest(viewer.position(), [&](int i) {
+          return i != v && is_seen(viewer, boids[i], angle);
+        })};
+        std::vector<Boid> others{boids};
+        others[v] = Boid{viewer.position(), viewer.velocity(), true};
+        CHECK(nearest == brute_nearest(others, viewer, angle));
+      }
+    }
+    CHECK(tree.nearest({50., 50.}, [](int) { return false; }) == -1);
+  }
+
+  SUBCASE("clustered boids get a deeper tree")
+  {
+    scatter(boids, 400, 50., 50., 50., 2u);
+    tree.build(boids, pars);
+    int const uniform_depth{tree.depth()};
+    boids.clear();
+    // crowds in the corner refuges, plus a tight flock
+    scatter(boids, 100, 2., 2., 2., 3u);
+    scatter(boids, 100, 98., 98., 2., 4u);
+    scatter(boids, 200, 40., 60., 1., 5u);
+    tree.build(boids, pars);
+    CHECK(tree.depth() > uniform_depth);
+    for (int v{0}; v < 400; v += 9) {
+      std::vector<int> selected;
+      tree.select(boids[v], 300., 3., selected);
+      CHECK(selected == brute_force(boids, boids[v], 300., 3.));
+    }
+  }
+
+  SUBCASE("coinciding and out of the box boids")
+  {
+    for (int i{0}; i != 20; ++i) {
+      boids.push_back(Boid{{30., 30.}, {1., 0.}});
+    }
+    boids.push_back(Boid{{-2., 101.}, {1., 0.}});
+    boids.push_back(Boid{{-1., 100.}, {1., 0.}});
+    tree.build(boids, pars);
+    CHECK(tree.depth() == Quadtree::max_depth);
+    std::vector<int> selected;
+    CHECK(tree.select(boids[0], 300., 1., selected).size() == 20u);
+    selected.clear();
+    CHECK(tree.select(boids[20], 300., 2., selected)
+          == std::vector<int>{20, 21});
+    tree.clear();
+    CHECK_FALSE(tree.built());
+  }
+}
@@ -0,0 +1,49 @@
+#include "random.hpp"
+
+// defines Philox4x32-10's rounds and its constructor
+
+namespace {
+// multipliers and Weyl key increments suggested by the authors
+constexpr std::uint32_t m0{0xD2511F53};
+constexpr std::uint32_t m1{0xCD9E8D57};
+constexpr std::uint32_t w0{0x9E3779B9};
+constexpr std::uint32_t w1{0xBB67AE85};
+
+std::array<std::uint32_t, 4> round(std::array<std::uint32_t, 4> const& c,
+                                   std::array<std::uint32_t, 2> const& k)
+{
+  std::uint64_t const p0{std::uint64_t{m0} * c[0]};
+  std::uint64_t const p1{std::uint64_t{m1} * c[2]};
+  return {static_cast<std::uint32_t>(p1 >> 32) ^ c[1] ^ k[0],
+          static_cast<std::uint32_t>(p1),
+          static_cast<std::uint32_t>(p0 >> 32) ^ c[3] ^ k[1],
+          static_cast<std::uint32_t>(p0)};
+}
+} // namespace
+
+std::array<std::uint32_t, 4> philox(std::array<std::uint32_t, 4> counter,
+                                    std::array<std::uint32_t, 2> key)
+{
+  for (int r{0}; r != 10; ++r) {
+    if (r != 0) { // key is bumped between rounds
+      key[0] += w0;
+      key[1] += w1;
+    }
+    counter = round(counter, key);
+  }
+  return counter;
+}
+
+Philox::Philox(std::uint32_t seed, std::uint32_t simulation, Stream stream)
+    : key_{seed, simulation}
+    , stream_{static_cast<std::uint32_t>(stream)}
+{}
+
+std::array<std::uint32_t, 4> Philox::operator()(std::uint64_t counter) const
+{
+  // the stream occupies the third word of the counter, so that different
+  // streams never share a block
+  return philox({static_cast<std::uint32_t>(counter),
+                 static_cast<std::uint32_t>(counter >> 32), stream_, 0u},
+                key_);
+}
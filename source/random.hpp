@@ -0,0 +1,44 @@
+#ifndef RANDOM_HPP
+#define RANDOM_HPP
+
+#include <array>
+#include <cstdint>
+
+// defines Philox (a counter-based random number generator) and the streams in
+// which random numbers of a simulation are split
+
+// independent sequences of random numbers belonging to the same simulation
+enum class Stream : std::uint32_t
+{
+  preys     = 0,
+  predators = 1
+};
+
+// Philox4x32-10 (Salmon et al., "Parallel random numbers: as easy as 1, 2,
+// 3"). Unlike std::default_random_engine, it has no internal state: the n-th
+// block of four random unsigned ints is a pure function of the key and of n,
+// so blocks can be generated in any order, in parallel and without replaying
+// the previous ones
+class Philox
+{
+  std::array<std::uint32_t, 2> key_;
+  std::uint32_t stream_;
+
+ public:
+  // the key identifies the batch (seed) and the simulation within it
+  explicit Philox(std::uint32_t seed, std::uint32_t simulation, Stream stream);
+  std::array<std::uint32_t, 4> operator()(std::uint64_t counter) const;
+};
+
+// bare Philox4x32-10 bijection, exposed for testing against known answers
+std::array<std::uint32_t, 4> philox(std::array<std::uint32_t, 4> counter,
+                                    std::array<std::uint32_t, 2> key);
+
+// maps a random unsigned int to a double in [min, max)
+inline double uniform(std::uint32_t bits, double min, double max)
+{
+  // 2^-32: bits * 2^-32 is in [0, 1)
+  return min + (max - min) * (bits * 2.3283064365386963e-10);
+}
+
+#endif
@@ -0,0 +1,44 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "random.hpp"
+#include "doctest.h"
+
+TEST_CASE("testing philox")
+{
+  SUBCASE("known answers of Philox4x32-10")
+  {
+    // reference values published with the Random123 library
+    CHECK(philox({0u, 0u, 0u, 0u}, {0u, 0u})
+          == std::array<std::uint32_t, 4>{0x6627e8d5, 0xe169c58d, 0xbc57ac4c,
+                                          0x9b00dbd8});
+    CHECK(philox({0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff},
+                 {0xffffffff, 0xffffffff})
+          == std::array<std::uint32_t, 4>{0x408f276d, 0x41c83b0e, 0xa20bc7c6,
+                                          0x6d5451fd});
+    CHECK(philox({0x243f6a88, 0x85a308d3, 0x13198a2e, 0x03707344},
+                 {0xa4093822, 0x299f31d0})
+          == std::array<std::uint32_t, 4>{0xd16cfe09, 0x94fdcceb, 0x5001e420,
+                                          0x24126ea1});
+  }
+
+  SUBCASE("blocks depend only on key, stream and counter")
+  {
+    Philox const gen{42u, 7u, Stream::preys};
+    auto const block{gen(1000)};
+    // generating other blocks first does not alter block 1000
+    Philox const gen1{42u, 7u, Stream::preys};
+    gen1(0);
+    gen1(999);
+    CHECK(gen1(1000) == block);
+    // different simulations and streams yield different blocks
+    CHECK_FALSE(Philox{42u, 8u, Stream::preys}(1000) == block);
+    CHECK_FALSE(Philox{42u, 7u, Stream::predators}(1000) == block);
+    CHECK_FALSE(Philox{43u, 7u, Stream::preys}(1000) == block);
+  }
+
+  SUBCASE("testing uniform")
+  {
+    CHECK(uniform(0u, -2., 3.) == -2.);
+    CHECK(uniform(0xffffffff, -2., 3.) < 3.);
+    CHECK(uniform(0x80000000, 0., 100.) == 50.);
+  }
+}
@@ -2,12 +2,212 @@
 #include <algorithm>
 #include <cmath>
 #include <fstream>
+#include <functional>
 #include <numeric>
 #include <sstream>
 
 // defines functions for analyzing, printing and saving data
 
-void write_counter(std::array<double, simulations> const& preys_eaten,
+double mean(std::vector<double> const& sample)
+{
+  assert(!sample.empty());
+  return std::accumulate(sample.begin(), sample.end(), 0.) / sample.size();
+}
+
+double std_error(std::vector<double> const& sample)
+{
+  assert(sample.size() > 1);
+  double const m{mean(sample)};
+  double const sum_sq{std::accumulate(
+      sample.begin(), sample.end(), 0.,
+      [=](double sum, double x) { return sum + (x - m) * (x - m); })};
+  // square root of the (unbiased) sample variance of the mean
+  return std::sqrt(sum_sq / (sample.size() - 1) / sample.size());
+}
+
+double ks_statistic(std::vector<double> sample1, std::vector<double> sample2)
+{
+  assert(!sample1.empty() && !sample2.empty());
+  std::sort(sample1.begin(), sample1.end());
+  std::sort(sample2.begin(), sample2.end());
+  double const n1{static_cast<double>(sample1.size())};
+  double const n2{static_cast<double>(sample2.size())};
+  auto it1{sample1.begin()};
+  auto it2{sample2.begin()};
+  double max_dist{0.};
+  while (it1 != sample1.end() && it2 != sample2.end()) {
+    // steps over all the values equal to the smallest one left (ties)
+    double const x{std::min(*it1, *it2)};
+    it1 = std::upper_bound(it1, sample1.end(), x);
+    it2 = std::upper_bound(it2, sample2.end(), x);
+    max_dist = std::max(max_dist, std::abs((it1 - sample1.begin()) / n1
+                                           - (it2 - sample2.begin()) / n2));
+  }
+  return max_dist;
+}
+
+double ks_p_value(double statistic, int size1, int size2)
+{
+  double const n_eff{std::sqrt(1. * size1 * size2 / (size1 + size2))};
+  double const lambda{(n_eff + .12 + .11 / n_eff) * statistic};
+  if (lambda < .2) { // the series below converges too slowly, but p ~ 1
+    return 1.;
+  }
+  // Kolmogorov distribution's tail: 2 sum_k (-1)^(k-1) exp(-2 k^2 lambda^2)
+  double p{0.};
+  for (int k{1}; k != 101; ++k) {
+    double const term{2. * std::exp(-2. * k * k * lambda * lambda)};
+    p += (k % 2 == 1) ? term : -term;
+    if (term < 1e-12) {
+      break;
+    }
+  }
+  return std::clamp(p, 0., 1.);
+}
+
+double normal_quantile(double p)
+{
+  assert(p > 0. && p < 1.);
+  static constexpr double a[]{-3.969683028665376e+01, 2.209460984245205e+02,
+                              -2.759285104469687e+02, 1.383577518672690e+02,
+                              -3.066479806614716e+01, 2.506628277459239e+00};
+  static constexpr double b[]{-5.447609879822406e+01, 1.615858368580409e+02,
+                              -1.556989798598866e+02, 6.680131188771972e+01,
+                              -1.328068155288572e+01};
+  static constexpr double c[]{-7.784894002430293e-03, -3.223964580411365e-01,
+                              -2.400758277161838e+00, -2.549732539343734e+00,
+                              4.374664141464968e+00,  2.938163982698783e+00};
+  static constexpr double d[]{7.784695709041462e-03, 3.224671290700398e-01,
+                              2.445134137142996e+00, 3.754408661907416e+00};
+  double const p_low{.02425};
+  if (p > 1. - p_low) { // upper tail, by symmetry
+    return -normal_quantile(1. - p);
+  }
+  if (p < p_low) {
+    double const q{std::sqrt(-2. * std::log(p))};
+    return (((((c[0] * q + c[1]) * q + c[2]) * q + c[3]) * q + c[4]) * q
+            + c[5])
+         / ((((d[0] * q + d[1]) * q + d[2]) * q + d[3]) * q + 1.);
+  }
+  double const q{p - .5};
+  double const r{q * q};
+  return (((((a[0] * r + a[1]) * r + a[2]) * r + a[3]) * r + a[4]) * r + a[5])
+       * q
+       / (((((b[0] * r + b[1]) * r + b[2]) * r + b[3]) * r + b[4]) * r + 1.);
+}
+
+// the expansion drifts from the exact quantiles below 5 degrees of freedom,
+// whose distributions have closed forms: the quantile is exact for 1, 2 and 4
+// (Hill, 1970), found by Newton's method on the distribution function for 3
+double t_quantile(double p, int dof)
+{
+  assert(p > 0. && p < 1.);
+  assert(dof > 0);
+  double const pi{std::acos(-1.)};
+  if (dof == 1) {
+    return std::tan(pi * (p - .5));
+  }
+  if (dof == 2) {
+    return (2. * p - 1.) / std::sqrt(2. * p * (1. - p));
+  }
+  if (dof == 4) {
+    double const alpha{std::sqrt(4. * p * (1. - p))};
+    double const q{std::cos(std::acos(alpha) / 3.) / alpha};
+    return ((p < .5) ? -2. : 2.) * std::sqrt(q - 1.);
+  }
+  if (dof == 3) {
+    double const root3{std::sqrt(3.)};
+    // starts from the quantile of 4 degrees of freedom, which lies between it
+    // and the median: the distribution function is concave beyond the median,
+    // so the iterates approach the quantile monotonically
+    double t{t_quantile(p, 4)};
+    for (int k{0}; k != 100; ++k) {
+      double const u{1. + t * t / 3.};
+      double const cdf{.5 + (t / (root3 * u) + std::atan(t / root3)) / pi};
+      double const density{2. / (pi * root3 * u * u)};
+      double const step{(cdf - p) / density};
+      t -= step;
+      if (std::abs(step) <= 1e-14 * (1. + std::abs(t))) {
+        break;
+      }
+    }
+    return t;
+  }
+  double const z{normal_quantile(p)};
+  double const z2{z * z};
+  double const n{static_cast<double>(dof)};
+  // terms of the expansion in powers of 1/dof (Abramowitz and Stegun 26.7.5)
+  double const g1{z * (z2 + 1.) / 4.};
+  double const g2{z * ((5. * z2 + 16.) * z2 + 3.) / 96.};
+  double const g3{z * (((3. * z2 + 19.) * z2 + 17.) * z2 - 15.) / 384.};
+  double const g4{
+      z * ((((79. * z2 + 776.) * z2 + 1482.) * z2 - 1920.) * z2 - 945.)
+      / 92160.};
+  return z + g1 / n + g2 / (n * n) + g3 / (n * n * n) + g4 / (n * n * n * n);
+}
+
+double ci_half_width(std::vector<double> const& sample, double level)
+{
+  assert(level > 0. && level < 1.);
+  int const dof{static_cast<int>(sample.size()) - 1};
+  return t_quantile(.5 + .5 * level, dof) * std_error(sample);
+}
+
+std::vector<double> differences(std::vector<double> const& sample1,
+                                std::vector<double> const& sample2)
+{
+  assert(sample1.size() == sample2.size());
+  std::vector<double> diffs(sample1.size());
+  std::transform(sample1.begin(), sample1.end(), sample2.begin(),
+                 diffs.begin(), std::minus<>{});
+  return diffs;
+}
+
+void print_paired(std::array<std::vector<double>, 3> const& counts,
+                  double level)
+{
+  std::array<char const*, 3> const names{"nearest", "isolated", "centre"};
+  int const sims{static_cast<int>(counts[0].size())};
+  std::cout << std::setfill(' ') << std::fixed << std::setprecision(0)
+            << "\nPaired comparison of seek types over " << sims
+            << " simulations (" << 100. * level << "% intervals)\n"
+            << std::setprecision(3);
+  for (int k{0}; k != 3; ++k) {
+    std::cout << std::setw(10) << names[k] << ": mean " << mean(counts[k])
+              << " +- " << ci_half_width(counts[k], level) << '\n';
+  }
+  for (int k{0}; k != 3; ++k) {
+    for (int l{k + 1}; l != 3; ++l) {
+      std::vector<double> const diffs{differences(counts[l], counts[k])};
+      // interval of the difference of two independent batches of [sims]
+      double const unpaired{
+          t_quantile(.5 + .5 * level, 2 * sims - 2)
+          * std::sqrt(std::pow(std_error(counts[l]), 2)
+                      + std::pow(std_error(counts[k]), 2))};
+      double const paired{ci_half_width(diffs, level)};
+      std::cout << std::setw(10) << names[l] << " - " << names[k]
+                << ": mean " << mean(diffs) << " +- " << paired
+                << "  (unpaired: +- " << unpaired << ")\n";
+    }
+  }
+}
+
+void write_paired_counters(std::array<std::vector<double>, 3> const& counts)
+{
+  std::ofstream os{"paired_counter.txt"};
+  if (!os) {
+    throw std::ios_base::failure{
+        "ERROR: Cannot open file paired_counter.txt\n"};
+  }
+  os << "nearest isolated centre\n";
+  for (int i{0}; i != static_cast<int>(counts[0].size()); ++i) {
+    os << counts[0][i] << ' ' << counts[1][i] << ' ' << counts[2][i] << '\n';
+  }
+  std::cout << "\nSUCCESS! Data have been saved to file paired_counter.txt "
+               "in current directory\n";
+}
+
+void write_counter(std::vector<double> const& preys_eaten,
                    int const seek_type)
 {
   std::ofstream os{"preys_eaten_counter.txt"}; // opens file for writing
@@ -36,4 +236,48 @@ void write_counter(std::array<double, simulations> const& preys_eaten,
   }
   std::cout << "\nSUCCESS! Data have been saved to file preys_eaten_counter.txt "
                "in current directory\n";
-}
\ No newline at end of file
+}
+// writes capture events to capture_events.txt and, if recorded, the counter
+// after each step to counter_series.txt (one line per simulation)
+void write_capture_logs(std::vector<Capture_log> const& logs)
+{
+  std::ofstream os{"capture_events.txt"};
+  if (!os) {
+    throw std::ios_base::failure{
+        "ERROR: Cannot open file capture_events.txt\n"};
+  }
+  os << "simulation step predator prey x y distance\n";
+  for (int i{0}; i != static_cast<int>(logs.size()); ++i) {
+    if (logs[i].lost() > 0) {
+      std::cerr << "WARNING: " << logs[i].lost()
+                << " capture events of simulation " << i
+                << " exceeded the log capacity and were overwritten\n";
+    }
+    for (auto const& event : logs[i].events()) {
+      os << i << ' ' << event.step << ' ' << event.predator << ' '
+         << event.prey << ' ' << event.position.x() << ' '
+         << event.position.y() << ' ' << event.distance << '\n';
+    }
+  }
+  std::cout << "\nSUCCESS! Capture events have been saved to file "
+               "capture_events.txt in current directory\n";
+
+  if (std::none_of(logs.begin(), logs.end(), [](Capture_log const& log) {
+        return !log.series().empty();
+      })) {
+    return;
+  }
+  std::ofstream series_os{"counter_series.txt"};
+  if (!series_os) {
+    throw std::ios_base::failure{
+        "ERROR: Cannot open file counter_series.txt\n"};
+  }
+  for (auto const& log : logs) {
+    for (int count : log.series()) {
+      series_os << count << ' ';
+    }
+    series_os << '\n';
+  }
+  std::cout << "\nSUCCESS! Counter series have been saved to file "
+               "counter_series.txt in current directory\n";
+}
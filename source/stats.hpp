@@ -4,7 +4,43 @@
 #include <iomanip>
 #include <iostream>
 
-void write_counter(std::array<double, simulations> const& preys_eaten,
+// sample mean and standard error of the mean (sample has at least 2 values)
+double mean(std::vector<double> const& sample);
+double std_error(std::vector<double> const& sample);
+
+// two-sample Kolmogorov-Smirnov test: statistic (maximum distance between
+// the empirical distribution functions) and its asymptotic p-value
+double ks_statistic(std::vector<double> sample1, std::vector<double> sample2);
+double ks_p_value(double statistic, int size1, int size2);
+
+// quantiles at probability p in (0, 1) of the standard normal distribution
+// (Acklam's rational approximation, relative error below 1.2e-9) and of
+// Student's t distribution with [dof] degrees of freedom (exact for dof < 5,
+// else Cornish-Fisher expansion about the normal quantile, within 1e-4 of the
+// exact value for p in [.005, .995])
+double normal_quantile(double p);
+double t_quantile(double p, int dof);
+// half width of the two-sided confidence interval of the mean at confidence
+// [level] (e.g. .95), from the t distribution (sample has at least 2 values)
+double ci_half_width(std::vector<double> const& sample, double level);
+// sample1[i] - sample2[i], for samples of the same size
+std::vector<double> differences(std::vector<double> const& sample1,
+                                std::vector<double> const& sample2);
+
+// counts of every seek type (in seek type order) from the same simulations,
+// i.e. the same flocks and predators: prints their means and, for every pair
+// of seek types, the mean of the paired differences with its confidence
+// interval, against the interval the same number of unpaired simulations
+// would give
+void print_paired(std::array<std::vector<double>, 3> const& counts,
+                  double level);
+// one line per simulation, one column per seek type
+void write_paired_counters(std::array<std::vector<double>, 3> const& counts);
+
+void write_counter(std::vector<double> const& preys_eaten,
                    int const seek_type);
 
+// one log per simulation, in simulation order
+void write_capture_logs(std::vector<Capture_log> const& logs);
+
 #endif
\ No newline at end of file
@@ -0,0 +1,59 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "stats.hpp"
+#include "doctest.h"
+
+TEST_CASE("testing statistics")
+{
+  std::vector<double> const sample{2., 4., 4., 4., 5., 5., 7., 9.};
+
+  SUBCASE("testing mean and standard error")
+  {
+    CHECK(mean(sample) == 5.);
+    // unbiased variance is 32/7
+    CHECK(std_error(sample) == doctest::Approx(std::sqrt(32. / 7. / 8.)));
+    CHECK(std_error(std::vector<double>{3., 3.}) == 0.);
+  }
+
+  SUBCASE("testing Kolmogorov-Smirnov test")
+  {
+    CHECK(ks_statistic(sample, sample) == 0.);
+    CHECK(ks_statistic({1., 2., 3.}, {4., 5., 6.}) == 1.);
+    // ties between samples are stepped over together
+    CHECK(ks_statistic({1., 2., 2., 3.}, {2., 3., 3., 3.})
+          == doctest::Approx(.5));
+    CHECK(ks_p_value(0., 10, 10) == 1.);
+    // reference value: lambda = (sqrt(50) + .12 + .11 / sqrt(50)) * .3
+    CHECK(ks_p_value(.3, 100, 100) == doctest::Approx(0.000174).epsilon(.01));
+    CHECK(ks_p_value(1., 100, 100) == doctest::Approx(0.));
+  }
+
+  SUBCASE("testing quantiles and confidence intervals")
+  {
+    CHECK(normal_quantile(.5) == 0.);
+    CHECK(normal_quantile(.975) == doctest::Approx(1.959964).epsilon(1e-6));
+    CHECK(normal_quantile(.001) == doctest::Approx(-3.090232).epsilon(1e-6));
+    // reference values from tables of Student's t distribution
+    CHECK(t_quantile(.975, 9) == doctest::Approx(2.262157).epsilon(1e-5));
+    CHECK(t_quantile(.995, 29) == doctest::Approx(2.756386).epsilon(1e-5));
+    CHECK(t_quantile(.025, 99) == doctest::Approx(-1.984217).epsilon(1e-5));
+    CHECK(t_quantile(.975, 1) == doctest::Approx(12.706205).epsilon(1e-6));
+    CHECK(t_quantile(.975, 2) == doctest::Approx(4.302653).epsilon(1e-6));
+    CHECK(t_quantile(.975, 3) == doctest::Approx(3.182446).epsilon(1e-6));
+    CHECK(t_quantile(.995, 3) == doctest::Approx(5.840909).epsilon(1e-6));
+    CHECK(t_quantile(.005, 4) == doctest::Approx(-4.604095).epsilon(1e-6));
+    CHECK(t_quantile(.975, 4) == doctest::Approx(2.776445).epsilon(1e-6));
+    double const t_7{2.364624}; // 97.5% quantile with 7 degrees of freedom
+    CHECK(ci_half_width(sample, .95)
+          == doctest::Approx(t_7 * std::sqrt(32. / 7. / 8.)).epsilon(1e-4));
+  }
+
+  SUBCASE("testing paired differences")
+  {
+    std::vector<double> const shifted{3., 6., 5., 5., 6., 7., 8., 11.};
+    std::vector<double> const diffs{differences(shifted, sample)};
+    CHECK(diffs == std::vector<double>{1., 2., 1., 1., 1., 2., 1., 2.});
+    // the pairs move together: the differences vary much less than the
+    // samples
+    CHECK(ci_half_width(diffs, .95) < .3 * ci_half_width(sample, .95));
+  }
+}
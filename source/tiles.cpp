@@ -0,0 +1,157 @@
+#include "tiles.hpp"
+#include "parallel.hpp"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <thread>
+
+// defines Tiles' pass over the pairs of boids
+
+// pairs (a, b) with a <= b are visited a block of rows a at a time, tiles of b
+// in increasing order, so that every list grows in increasing order: a list
+// gets the lower boids of its pairs while their rows are visited, then its own
+// row. Squared distances of a boid to a tile are computed first, in a loop the
+// compiler can vectorize, and only then compared. Distances and visibility are
+// computed with the same operations as distance() and is_seen() (the
+// difference of positions seen from b is the exact opposite of the one seen
+// from a), so candidates carry their results exactly
+void Tiles::visit(int first, int last,
+                  std::vector<std::vector<Candidate>>& lists)
+{
+  int const n{static_cast<int>(xs_.size())};
+  // widened, to absorb the rounding of distance()
+  double const squared_radius{radius_ * radius_ * (1. + 1e-9)};
+  double const cos_view{std::cos(pi * angle_ / 360.)};
+  std::array<double, tile> squared;
+  for (int a0{first}; a0 < last; a0 += block) {
+    int const a1{std::min(a0 + block, last)};
+    for (int b0{a0}; b0 < n; b0 += tile) {
+      int const b1{std::min(b0 + tile, n)};
+      for (int a{a0}; a < a1 && a < b1; ++a) {
+        int const begin{std::max(b0, a)};
+        double const x{xs_[a]};
+        double const y{ys_[a]};
+        for (int b{begin}; b != b1; ++b) {
+          double const xdiff{xs_[b] - x};
+          double const ydiff{ys_[b] - y};
+          squared[b - b0] = xdiff * xdiff + ydiff * ydiff;
+        }
+        for (int b{begin}; b != b1; ++b) {
+          if (squared[b - b0] >= squared_radius
+              || !(regular_[a] || regular_[b])) {
+            continue;
+          }
+          if (b == a) {
+            lists[a].push_back({a, 0., true});
+            continue;
+          }
+          double const xdiff{xs_[b] - x};
+          double const ydiff{ys_[b] - y};
+          double const distance{std::sqrt(squared[b - b0])};
+          // coinciding boids always see each other
+          bool const coincide{xdiff == 0. && ydiff == 0.};
+          if (regular_[b]) {
+            double const scalar_prod{xdiff * v_xs_[a] + ydiff * v_ys_[a]};
+            bool const seen{
+                coincide
+                || scalar_prod / (speeds_[a] * distance) >= cos_view};
+            lists[a].push_back({b, distance, seen});
+          }
+          if (regular_[a]) {
+            double const scalar_prod{-xdiff * v_xs_[b] + -ydiff * v_ys_[b]};
+            bool const seen{
+                coincide
+                || scalar_prod / (speeds_[b] * distance) >= cos_view};
+            lists[b].push_back({a, distance, seen});
+          }
+        }
+      }
+    }
+  }
+}
+
+// rows are split among threads so that they visit about as many pairs each
+// (row a has n - a of them); every thread writes to its own buffers, which
+// are then merged
+void Tiles::build(std::vector<Boid> const& boids, double radius,
+                  double angle_of_view)
+{
+  assert(radius > 0.);
+  radius_ = radius;
+  angle_  = angle_of_view;
+  int const n{static_cast<int>(boids.size())};
+  xs_.resize(n);
+  ys_.resize(n);
+  v_xs_.resize(n);
+  v_ys_.resize(n);
+  speeds_.resize(n);
+  regular_.resize(n);
+  for (int i{0}; i != n; ++i) {
+    Boid const& b{boids[i]};
+    xs_[i]      = b.position().x();
+    ys_[i]      = b.position().y();
+    v_xs_[i]    = b.velocity().x();
+    v_ys_[i]    = b.velocity().y();
+    speeds_[i]  = norm(b.velocity());
+    regular_[i] = !b.is_pred() && !b.is_eaten();
+  }
+  double const pairs{.5 * n * n};
+  int const n_blocks{(n + block - 1) / block};
+  int const n_threads{
+      (pairs < parallel_pairs)
+          ? 1
+          : std::min(static_cast<int>(
+                         std::max(1u, std::thread::hardware_concurrency())),
+                     n_blocks)};
+  std::vector<int> bounds{0};
+  double visited{0.};
+  for (int a0{0}; a0 < n; a0 += block) {
+    visited += static_cast<double>(std::min(block, n - a0)) * (n - a0);
+    if (visited >= pairs * static_cast<int>(bounds.size()) / n_threads
+        && static_cast<int>(bounds.size()) < n_threads) {
+      bounds.push_back(std::min(a0 + block, n));
+    }
+  }
+  bounds.resize(n_threads, n);
+  bounds.push_back(n);
+  buffers_.resize(n_threads);
+  for (auto& lists : buffers_) {
+    lists.resize(n);
+    for (auto& list : lists) {
+      list.clear();
+    }
+  }
+  parallel_for(
+      0, n_threads,
+      [&](int t) { visit(bounds[t], bounds[t + 1], buffers_[t]); }, 1);
+  if (n_threads == 1) {
+    // the old lists become the buffers of the next build
+    lists_.swap(buffers_[0]);
+  } else {
+    lists_.resize(n);
+    for (int i{0}; i != n; ++i) {
+      lists_[i].clear();
+      for (auto const& lists : buffers_) {
+        lists_[i].insert(lists_[i].end(), lists[i].begin(), lists[i].end());
+      }
+    }
+  }
+  built_ = true;
+}
+
+int Tiles::size() const
+{
+  int total{0};
+  for (auto const& list : lists_) {
+    total += static_cast<int>(list.size());
+  }
+  return total;
+}
+
+void Tiles::clear()
+{
+  built_ = false;
+  for (auto& list : lists_) {
+    list.clear();
+  }
+}
@@ -0,0 +1,85 @@
+#ifndef TILES_HPP
+#define TILES_HPP
+
+#include "boids.hpp"
+#include <cassert>
+#include <vector>
+
+// defines Tiles, the neighbourhoods of all the boids of a flock found at once
+// by a cache-blocked pass over their pairs
+
+// coordinates and velocities of the boids are copied to contiguous arrays, and
+// blocks of boids are tested against tiles of them small enough for both to
+// stay in L1 cache while all their pairs are tested. Each unordered pair is
+// visited once: its distance is computed once, and whether each boid of the
+// pair sees the other is found from the same difference of positions. Every
+// boid of the flock gets the list of the alive regular boids within radius
+// (its candidates). Boids are referred to by their index in the flock
+class Tiles
+{
+ public:
+  struct Candidate
+  {
+    int index;
+    double distance; // as computed by distance()
+    bool seen;       // as found by is_seen() for the boid owning the list
+  };
+
+ private:
+  double radius_{0.};
+  double angle_{0.};
+  bool built_{false};
+  std::vector<double> xs_;
+  std::vector<double> ys_;
+  std::vector<double> v_xs_;
+  std::vector<double> v_ys_;
+  std::vector<double> speeds_;
+  std::vector<char> regular_; // whether the boid is alive and regular
+  // candidates of each boid, in increasing order
+  std::vector<std::vector<Candidate>> lists_;
+  // candidates found by each thread, merged into lists_ in thread order
+  std::vector<std::vector<std::vector<Candidate>>> buffers_;
+
+  void visit(int first, int last, std::vector<std::vector<Candidate>>& lists);
+
+ public:
+  // boids of a block and of a tile: the 5 * 512 doubles of a tile fit in L1
+  // cache together with the block's
+  static constexpr int block{64};
+  static constexpr int tile{512};
+  // pairs below which a single thread visits them all
+  static constexpr double parallel_pairs{1 << 20};
+
+  bool built() const
+  {
+    return built_;
+  }
+  double radius() const
+  {
+    return radius_;
+  }
+  double angle() const
+  {
+    return angle_;
+  }
+  int size() const;
+  // finds the candidates of every boid of boids, and whether it sees them
+  // within angle_of_view. Candidates are slightly more than the boids at
+  // distance() < radius, so that rounding never drops one
+  void build(std::vector<Boid> const& boids, double radius,
+             double angle_of_view);
+  void clear();
+
+  // calls f(candidate) for every candidate of the i-th boid, in increasing
+  // order of index. It is up to f to check the actual distance
+  template<class F>
+  void for_each_near(int i, F f) const
+  {
+    assert(built() && i >= 0 && i < static_cast<int>(lists_.size()));
+    for (Candidate const& candidate : lists_[i]) {
+      f(candidate);
+    }
+  }
+};
+
+#endif
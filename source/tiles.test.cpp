@@ -0,0 +1,96 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "tiles.hpp"
+#include "doctest.h"
+#include "random.hpp"
+
+namespace {
+// alive regular boids closer than r to the i-th boid and seen by it, by
+// checking every boid
+std::vector<int> brute_force(std::vector<Boid> const& boids, int i, double r,
+                             double angle)
+{
+  std::vector<int> close;
+  for (int j{0}; j != static_cast<int>(boids.size()); ++j) {
+    Boid const& b{boids[j]};
+    if (!b.is_pred() && !b.is_eaten() && distance(boids[i], b) < r
+        && is_seen(boids[i], b, angle)) {
+      close.push_back(j);
+    }
+  }
+  return close;
+}
+
+// candidates of the i-th boid closer than r and seen by it
+std::vector<int> near(Tiles const& tiles, int i, double r)
+{
+  std::vector<int> close;
+  tiles.for_each_near(i, [&](Tiles::Candidate const& candidate) {
+    if (candidate.seen && candidate.distance < r) {
+      close.push_back(candidate.index);
+    }
+  });
+  return close;
+}
+
+// indices of the candidates of the i-th boid
+std::vector<int> candidates(Tiles const& tiles, int i)
+{
+  std::vector<int> found;
+  tiles.for_each_near(i, [&](Tiles::Candidate const& candidate) {
+    found.push_back(candidate.index);
+  });
+  return found;
+}
+} // namespace
+
+TEST_CASE("testing tiles")
+{
+  Tiles tiles;
+  CHECK_FALSE(tiles.built());
+
+  SUBCASE("candidates match brute force")
+  {
+    // more boids than a block and a tile, so that lists span several tiles
+    std::vector<Boid> boids;
+    Philox const gen{7u, 0u, Stream::preys};
+    for (int i{0}; i != 1500; ++i) {
+      auto const bits{gen(i)};
+      Position const p{uniform(bits[0], 0., 100.), uniform(bits[1], 0., 100.)};
+      Velocity const v{uniform(bits[2], -1., 1.), uniform(bits[3], -1., 1.)};
+      boids.push_back((i % 50 == 0) ? Boid{p, v, true} : Boid{p, v});
+    }
+    boids[7].is_eaten() = true;
+    tiles.build(boids, 10., 270.);
+    CHECK(tiles.built());
+    CHECK(tiles.radius() == 10.);
+    CHECK(tiles.angle() == 270.);
+    for (int i{0}; i < 1500; i += 11) {
+      CHECK(near(tiles, i, 10.) == brute_force(boids, i, 10., 270.));
+      CHECK(near(tiles, i, 3.) == brute_force(boids, i, 3., 270.));
+      // each pair is evaluated once, for both of its boids
+      tiles.for_each_near(i, [&](Tiles::Candidate const& candidate) {
+        Boid const& other{boids[candidate.index]};
+        CHECK(candidate.distance == distance(boids[i], other));
+        CHECK(candidate.seen == is_seen(boids[i], other, 270.));
+      });
+    }
+    tiles.clear();
+    CHECK_FALSE(tiles.built());
+  }
+
+  SUBCASE("boids on the edge of the radius and coinciding ones")
+  {
+    std::vector<Boid> boids{Boid{{0., 0.}, {1., 0.}}, Boid{{3., 4.}, {1., 0.}},
+                            Boid{{0., 0.}, {1., 0.}},
+                            Boid{{0., 0.}, {1., 0.}, true}};
+    tiles.build(boids, 5., 90.);
+    // at distance 5 exactly: a candidate, not a neighbour within 5
+    CHECK(candidates(tiles, 0) == std::vector<int>{0, 1, 2});
+    CHECK(near(tiles, 0, 5.) == std::vector<int>{0, 2});
+    // the others are behind boid 1
+    CHECK(near(tiles, 1, 6.) == std::vector<int>{1});
+    // predators get candidates too, but are never candidates
+    CHECK(candidates(tiles, 3) == std::vector<int>{0, 1, 2});
+    CHECK(near(tiles, 3, 5.) == std::vector<int>{0, 2});
+  }
+}